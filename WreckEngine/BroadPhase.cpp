@@ -0,0 +1,367 @@
+#include "BroadPhase.h"
+
+#include <algorithm>
+
+#include "ColliderEntity.h"
+
+using namespace BroadPhase;
+
+unique<Base> BroadPhase::create(Type type) {
+    switch (type) {
+    case Type::AABB_TREE:
+        return make_unique<AABBTree>();
+    case Type::SWEEP_AND_PRUNE:
+    default:
+        return make_unique<SweepAndPrune>();
+    }
+}
+
+Bounds::Bounds(const AABB& aabb, float margin) : min(aabb.center - aabb.halfDims - vec3(margin)), max(aabb.center + aabb.halfDims + vec3(margin)) {}
+
+bool Bounds::contains(const Bounds& other) const {
+    return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+        && max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+}
+
+bool Bounds::overlaps(const Bounds& other) const {
+    return !(min.x > other.max.x || max.x < other.min.x
+          || min.y > other.max.y || max.y < other.min.y
+          || min.z > other.max.z || max.z < other.min.z);
+}
+
+// uses the surface area (halved), which is the standard cost heuristic for BVHs
+float Bounds::area() const {
+    const auto d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+Bounds Bounds::merge(const Bounds& a, const Bounds& b) {
+    Bounds merged;
+    merged.min = glm::min(a.min, b.min);
+    merged.max = glm::max(a.max, b.max);
+    return merged;
+}
+
+Bounds BroadPhase::sweptBounds(ColliderEntity* e, float margin) {
+    Bounds swept(e->collider()->aabb(), margin);
+    const auto motion = e->rigidBody.motion();
+    swept.min -= glm::max(motion, vec3());
+    swept.max -= glm::min(motion, vec3());
+    return swept;
+}
+
+void Base::resetPairs() {
+    overlaps.clear();
+    addedPairs.clear();
+    removedPairs.clear();
+    pairIndices.clear();
+}
+
+void Base::beginUpdate() {
+    addedPairs.clear();
+    removedPairs.clear();
+}
+
+void Base::addPair(const pair_t& p) {
+    if (!pairIndices.insert({ p, overlaps.size() }).second) return;
+    overlaps.push_back(p);
+    addedPairs.push_back(p);
+}
+
+// swaps the last pair into the removed pair's place, so only that pair's index changes
+void Base::removePair(const pair_t p) {
+    const auto it = pairIndices.find(p);
+    if (it == end(pairIndices)) return;
+
+    const auto index = it->second;
+    pairIndices.erase(it);
+    if (index != overlaps.size() - 1) {
+        overlaps[index] = overlaps.back();
+        pairIndices[overlaps[index]] = index;
+    }
+    overlaps.pop_back();
+    removedPairs.push_back(p);
+}
+
+void Base::removePairsWith(ColliderEntity* e) {
+    for (auto i = overlaps.size(); i-- > 0;) {
+        const auto p = overlaps[i];
+        if (p.first != e && p.second != e) continue;
+        removePair(p);
+        removedPairs.pop_back();
+    }
+}
+
+void Base::syncPairs(const pair_list& found) {
+    pairSeen.assign(overlaps.size(), 0);
+
+    const auto numPairs = overlaps.size();
+    for (const auto& p : found) {
+        if (const auto it = pairIndices.find(p); it != end(pairIndices) && it->second < numPairs)
+            pairSeen[it->second] = 1;
+        else
+            addPair(p);
+    }
+
+    // going backwards means anything swapped into a removed pair's place has already been checked
+    for (auto i = numPairs; i-- > 0;) {
+        if (!pairSeen[i]) removePair(overlaps[i]);
+    }
+}
+
+void SweepAndPrune::add(ColliderEntity* e) {
+    uint32_t index;
+    if (freeProxies.size()) {
+        index = freeProxies.back();
+        freeProxies.pop_back();
+    }
+    else {
+        index = (uint32_t)proxies.size();
+        proxies.emplace_back();
+    }
+    proxies[index].entity = e;
+    proxies[index].bounds = sweptBounds(e);
+    proxyIndices[e] = index;
+
+    // the new endpoints go at the end; the next sort moves them into place, adding their pairs along the way
+    for (auto axis = 0; axis < 3; ++axis) {
+        endpoints[axis].push_back({ proxies[index].bounds.min[axis], index << 1 });
+        endpoints[axis].push_back({ proxies[index].bounds.max[axis], (index << 1) | 1 });
+    }
+}
+
+void SweepAndPrune::remove(ColliderEntity* e) {
+    const auto it = proxyIndices.find(e);
+    if (it == end(proxyIndices)) return;
+
+    const auto index = it->second;
+    for (auto& axisEndpoints : endpoints) {
+        axisEndpoints.erase(std::remove_if(begin(axisEndpoints), end(axisEndpoints), [index](const Endpoint& ep) { return ep.proxy() == index; }), end(axisEndpoints));
+    }
+    removePairsWith(e);
+
+    proxies[index].entity = nullptr;
+    freeProxies.push_back(index);
+    proxyIndices.erase(it);
+}
+
+void SweepAndPrune::clear() {
+    for (auto& axisEndpoints : endpoints) axisEndpoints.clear();
+    proxies.clear();
+    freeProxies.clear();
+    proxyIndices.clear();
+    resetPairs();
+}
+
+void SweepAndPrune::update() {
+    beginUpdate();
+
+    for (auto& proxy : proxies) {
+        if (proxy.entity) proxy.bounds = sweptBounds(proxy.entity);
+    }
+
+    for (auto axis = 0; axis < 3; ++axis) {
+        for (auto& ep : endpoints[axis]) {
+            const auto& bounds = proxies[ep.proxy()].bounds;
+            ep.value = ep.isMax() ? bounds.max[axis] : bounds.min[axis];
+        }
+        sortAxis(axis);
+    }
+}
+
+void SweepAndPrune::sortAxis(int axis) {
+    auto& axisEndpoints = endpoints[axis];
+    for (size_t i = 1, numEndpoints = axisEndpoints.size(); i < numEndpoints; ++i) {
+        const auto curr = axisEndpoints[i];
+        auto j = i;
+        for (; j > 0 && curr.value < axisEndpoints[j - 1].value; --j) {
+            const auto prev = axisEndpoints[j - 1];
+            axisEndpoints[j] = prev;
+
+            // the current endpoint is moving below the previous one; only min/max swaps change the overlap
+            if (curr.isMax() == prev.isMax()) continue;
+            const auto a = curr.proxy(), b = prev.proxy();
+            if (a == b) continue;
+
+            if (curr.isMax())
+                removePair(makePair(a, b));
+            else if (proxies[a].bounds.overlaps(proxies[b].bounds))
+                addPair(makePair(a, b));
+        }
+        axisEndpoints[j] = curr;
+    }
+}
+
+BroadPhase::pair_t SweepAndPrune::makePair(uint32_t a, uint32_t b) const {
+    return a < b ? pair_t{ proxies[a].entity, proxies[b].entity } : pair_t{ proxies[b].entity, proxies[a].entity };
+}
+
+int32_t AABBTree::allocNode() {
+    if (freeNodes.size()) {
+        const auto node = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[node] = Node();
+        return node;
+    }
+    nodes.emplace_back();
+    return (int32_t)nodes.size() - 1;
+}
+
+void AABBTree::freeNode(int32_t node) {
+    nodes[node].entity = nullptr;
+    freeNodes.push_back(node);
+}
+
+void AABBTree::add(ColliderEntity* e) {
+    const auto leaf = allocNode();
+    nodes[leaf].entity = e;
+    nodes[leaf].bounds = sweptBounds(e, margin);
+    leaves[e] = leaf;
+    insertLeaf(leaf);
+}
+
+void AABBTree::remove(ColliderEntity* e) {
+    const auto it = leaves.find(e);
+    if (it == end(leaves)) return;
+    removeLeaf(it->second);
+    freeNode(it->second);
+    leaves.erase(it);
+    removePairsWith(e);
+}
+
+void AABBTree::clear() {
+    nodes.clear();
+    freeNodes.clear();
+    leaves.clear();
+    resetPairs();
+    root = null_node;
+}
+
+void AABBTree::update() {
+    beginUpdate();
+
+    // leaves are visited in node order rather than through [leaves], which is ordered by address,
+    // so the tree is reshaped and the pairs are found in the same order every run
+    // only leaves whose colliders have left their fat bounds need to be moved
+    for (int32_t leaf = 0; leaf < (int32_t)nodes.size(); ++leaf) {
+        const auto entity = nodes[leaf].entity;
+        if (!entity || nodes[leaf].bounds.contains(sweptBounds(entity))) continue;
+
+        removeLeaf(leaf);
+        nodes[leaf].bounds = sweptBounds(entity, margin);
+        insertLeaf(leaf);
+    }
+
+    // the tree has to be re-queried to find the overlaps, so the differences are found against the previous results
+    found.clear();
+    for (int32_t leaf = 0, numNodes = (int32_t)nodes.size(); leaf < numNodes; ++leaf) {
+        if (nodes[leaf].entity) queryLeaf(leaf);
+    }
+    syncPairs(found);
+}
+
+// walks down the tree choosing the child that results in the lowest increase in surface area
+void AABBTree::insertLeaf(int32_t leaf) {
+    if (root == null_node) {
+        root = leaf;
+        nodes[root].parent = null_node;
+        return;
+    }
+
+    const auto leafBounds = nodes[leaf].bounds;
+    auto sibling = root;
+    while (!nodes[sibling].isLeaf()) {
+        const auto& node = nodes[sibling];
+        const auto area = node.bounds.area();
+        const auto mergedArea = Bounds::merge(node.bounds, leafBounds).area();
+
+        // cost of creating a new parent for this node and the leaf, and the minimum cost of pushing the leaf further down
+        const auto cost = 2.f * mergedArea;
+        const auto inheritance = 2.f * (mergedArea - area);
+
+        const auto childCost = [&](int32_t child) {
+            const auto& childBounds = nodes[child].bounds;
+            const auto merged = Bounds::merge(childBounds, leafBounds).area();
+            return nodes[child].isLeaf() ? merged + inheritance : (merged - childBounds.area()) + inheritance;
+        };
+
+        const auto leftCost = childCost(node.left), rightCost = childCost(node.right);
+        if (cost < leftCost && cost < rightCost) break;
+
+        sibling = leftCost < rightCost ? node.left : node.right;
+    }
+
+    const auto oldParent = nodes[sibling].parent;
+    const auto newParent = allocNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = Bounds::merge(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].left   = sibling;
+    nodes[newParent].right  = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent    = newParent;
+
+    if (oldParent == null_node) {
+        root = newParent;
+    }
+    else {
+        auto& parent = nodes[oldParent];
+        (parent.left == sibling ? parent.left : parent.right) = newParent;
+        refit(oldParent);
+    }
+}
+
+void AABBTree::removeLeaf(int32_t leaf) {
+    if (leaf == root) {
+        root = null_node;
+        return;
+    }
+
+    const auto parent = nodes[leaf].parent;
+    const auto grandParent = nodes[parent].parent;
+    const auto sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    // the sibling takes the parent's place
+    if (grandParent == null_node) {
+        root = sibling;
+        nodes[sibling].parent = null_node;
+    }
+    else {
+        auto& gp = nodes[grandParent];
+        (gp.left == parent ? gp.left : gp.right) = sibling;
+        nodes[sibling].parent = grandParent;
+        refit(grandParent);
+    }
+    freeNode(parent);
+}
+
+void AABBTree::refit(int32_t node) {
+    for (; node != null_node; node = nodes[node].parent) {
+        auto& curr = nodes[node];
+        curr.bounds = Bounds::merge(nodes[curr.left].bounds, nodes[curr.right].bounds);
+    }
+}
+
+// finds all other leaves overlapping this one; each pair is only reported by the leaf with the lower index
+void AABBTree::queryLeaf(int32_t leaf) {
+    const auto& leafNode = nodes[leaf];
+    const auto tight = sweptBounds(leafNode.entity);
+
+    queryStack.clear();
+    queryStack.push_back(root);
+    while (queryStack.size()) {
+        const auto curr = queryStack.back();
+        queryStack.pop_back();
+
+        const auto& node = nodes[curr];
+        if (!node.bounds.overlaps(leafNode.bounds)) continue;
+
+        if (node.isLeaf()) {
+            if (curr > leaf && tight.overlaps(sweptBounds(node.entity)))
+                found.push_back({ leafNode.entity, node.entity });
+        }
+        else {
+            queryStack.push_back(node.left);
+            queryStack.push_back(node.right);
+        }
+    }
+}
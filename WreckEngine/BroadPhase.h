@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "smart_ptr.h"
+
+#include "Collider.h"
+
+class ColliderEntity;
+
+/*
+----------------------------------------------------------------------
+- The broad phase is responsible for culling the set of all collider pairs down to those that could possibly collide
+- Every implementation tracks the AABBs of the colliders added to it and produces only the pairs whose AABBs overlap
+- They're kept up to date incrementally through update(), which is called once before every narrow phase pass
+
+- The overlapping pairs persist between updates; a pair stays in the list (in the same order) for as long as it overlaps
+  - Each update reports the pairs that started and stopped overlapping through added() and removed()
+  - Pairs are always ordered the same way for their whole lifetime, so they can be used as keys for per-pair data
+
+- Moving rigid bodies use the AABB swept over their last move, from where they started to where they ended up
+  - So a body fast enough to pass through something in a single tick still gets paired with it, and CCD can find where they hit
+
+- Sweep and prune works best when most objects are at rest or move coherently, as the sort does very little work
+- The AABB tree works best for scenes with very uneven distributions, or lots of objects moving quickly
+----------------------------------------------------------------------
+*/
+namespace BroadPhase {
+
+    using pair_t = std::pair<ColliderEntity*, ColliderEntity*>;
+    using pair_list = std::vector<pair_t>;
+
+    struct pair_hash { auto operator()(const pair_t& p) const noexcept { return hash_bytes(p); } };
+
+    enum class Type { SWEEP_AND_PRUNE, AABB_TREE };
+
+    // min/max representation of an AABB, which is much more convenient for the broad phase
+    struct Bounds {
+        vec3 min, max;
+        Bounds() = default;
+        Bounds(const AABB& aabb, float margin = 0.f);
+        bool contains(const Bounds& other) const;
+        bool overlaps(const Bounds& other) const;
+        float area() const;
+        static Bounds merge(const Bounds& a, const Bounds& b);
+    };
+
+    // the bounds of [e]'s collider swept back over its rigid body's last move
+    Bounds sweptBounds(ColliderEntity* e, float margin = 0.f);
+
+    // defines the general broad phase interface
+    struct Base {
+        virtual ~Base() = default;
+
+        virtual void add(ColliderEntity* e) = 0;
+        virtual void remove(ColliderEntity* e) = 0;
+        virtual void clear() = 0;
+
+        // refreshes the structure from the current collider AABBs and updates the overlapping pairs
+        virtual void update() = 0;
+
+        const pair_list& pairs()   const { return overlaps; }
+        const pair_list& added()   const { return addedPairs; }   // pairs that started overlapping in the last update
+        const pair_list& removed() const { return removedPairs; } // pairs that stopped overlapping in the last update; removing an entity doesn't report its pairs
+    protected:
+        void resetPairs();
+        void beginUpdate();
+
+        void addPair(const pair_t& p);
+        void removePair(const pair_t p); // by value, as it may be passed an element of the pair list
+        void removePairsWith(ColliderEntity* e);
+        // replaces the current pairs with [found], recording the differences
+        void syncPairs(const pair_list& found);
+
+    private:
+        pair_list overlaps, addedPairs, removedPairs;
+        std::unordered_map<pair_t, size_t, pair_hash> pairIndices;
+        std::vector<char> pairSeen;
+    };
+
+    unique<Base> create(Type type);
+
+    /*
+    ----------------------------------------------------------------------
+    - Keeps sorted arrays of the min and max endpoints of every AABB on each axis, which persist between updates
+    - Each update refreshes the endpoint values and re-sorts them with insertion sort;
+      because objects move very little between ticks the arrays are nearly sorted, making this close to O(n)
+    - Every swap during the sort signals a change in overlap on that axis:
+      - a min moving below a max means the intervals have started overlapping, so the pair is added if it overlaps on all axes
+      - a max moving below a min means the intervals have stopped overlapping, so the pair is removed
+    - Objects at rest don't cause any swaps, so they cost nothing beyond refreshing their endpoint values
+    ----------------------------------------------------------------------
+    */
+    class SweepAndPrune : public Base {
+    public:
+        void add(ColliderEntity* e) override;
+        void remove(ColliderEntity* e) override;
+        void clear() override;
+        void update() override;
+    private:
+        struct Endpoint {
+            float value;
+            uint32_t data; // the index of the proxy shifted left by 1, with the lowest bit set if it's a max
+
+            uint32_t proxy() const { return data >> 1; }
+            bool isMax() const { return (data & 1) != 0; }
+        };
+
+        struct Proxy {
+            ColliderEntity* entity = nullptr;
+            Bounds bounds;
+        };
+
+        std::vector<Endpoint> endpoints[3];
+        std::vector<Proxy> proxies; // proxy indices are stable, which keeps pair ordering consistent
+        std::vector<uint32_t> freeProxies;
+        std::unordered_map<ColliderEntity*, uint32_t> proxyIndices;
+
+        void sortAxis(int axis);
+        pair_t makePair(uint32_t a, uint32_t b) const;
+    };
+
+    // dynamic bounding volume hierarchy; leaves store "fat" AABBs expanded by a margin,
+    // so a leaf is only reinserted when its collider moves outside of the fat AABB
+    class AABBTree : public Base {
+    public:
+        explicit AABBTree(float _margin = 0.2f) : margin(_margin) {}
+
+        void add(ColliderEntity* e) override;
+        void remove(ColliderEntity* e) override;
+        void clear() override;
+        void update() override;
+    private:
+        static constexpr int32_t null_node = -1;
+
+        struct Node {
+            Bounds bounds;
+            int32_t parent = null_node, left = null_node, right = null_node;
+            ColliderEntity* entity = nullptr; // only leaves hold an entity
+            bool isLeaf() const { return left == null_node; }
+        };
+
+        std::vector<Node> nodes;
+        std::vector<int32_t> freeNodes;
+        std::unordered_map<ColliderEntity*, int32_t> leaves;
+        std::vector<int32_t> queryStack;
+        pair_list found;
+        int32_t root = null_node;
+        const float margin;
+
+        int32_t allocNode();
+        void freeNode(int32_t node);
+
+        void insertLeaf(int32_t leaf);
+        void removeLeaf(int32_t leaf);
+        void refit(int32_t node);
+        void queryLeaf(int32_t leaf);
+    };
+}
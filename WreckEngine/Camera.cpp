@@ -11,8 +11,8 @@ Camera::Camera()
 mat4 Camera::getCamMat() { return _projection * _view; }
 
 void Camera::update(double dt) {
-    auto t = transform.getComputed();
-    _view = glm::lookAt(t->position(), getLookAt(), t->up());
+    const auto t = transform.getComputed();
+    _view = glm::lookAt(t.position(), getLookAt(), t.up());
     updateFrustum();
 }
 
@@ -54,8 +54,8 @@ void Camera::turn(float dx, float dy) {
 }
 
 vec3 Camera::getLookAt(float units) {
-    auto t = transform.getComputed();
-    return t->position() + t->forward() * units;
+    const auto t = transform.getComputed();
+    return t.position() + t.forward() * units;
 }
 
 void Camera::updateProjection() {
@@ -1,24 +1,43 @@
 #include "Collider.h"
 
+#include <algorithm>
+#include <array>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "GJK.h"
 #include <iostream>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define COLLIDER_SSE
+#include <emmintrin.h>
+#endif
+
 Collider::Collider(Transform* t, const vec3 d, const bool fudge) : Collider(Type::BOX, nullptr, t, d, fudge) { }
+Collider::Collider(Transform* t, const float r) : Collider(Type::SPHERE, nullptr, t, vec3(r)) { }
 Collider::Collider(shared<Mesh> m, Transform* t) : Collider(Type::MESH, m, t, m->getPreciseDims()) { }
-Collider::Collider(const Type type, shared<Mesh> m, Transform* t, const vec3 d, const bool fudge) : _type(type), mesh(m), _transform(t), fudgeAABB(fudge) 
+Collider::Collider(const Type type, shared<Mesh> m, Transform* t, const vec3 d, const bool fudge) : _type(type), _transform(t), fudgeAABB(fudge) 
 {
     dims(d);
-    base_aabb.center = _transform->getComputed()->position();
+    base_aabb.center = _transform->getComputed().position();
     transformed_aabb = base_aabb;
     updateDims();
-    // the order is important;
-    // edges depend on the gauss map, which depends on the normals
-    genVerts();
-    genNormals();
-    genGaussMap();
-    genEdges();
+    switch (_type) {
+    case Type::SPHERE: shape = ColliderShape::sphere(); break;
+    case Type::BOX:    break; // dims() already gave it its shape
+    case Type::MESH:   shape = ColliderShape::get(m);   break;
+    }
+    supportHint.object.store(0, std::memory_order_relaxed);
     update();
 }
 
+void Collider::setDims(const vec3 value) {
+    _dims = base_aabb.halfDims = value;
+    if (_type == Type::BOX) shape = ColliderShape::box(value);
+    updateDims();
+}
+
 // makes sure the radius and AABB scale are up to date
 // IMPORTANT NOTE:
 // using non-uniform scaling requires the use of the inverse-transpose of the transformation matrix to transform normals properly
@@ -26,11 +45,12 @@ Collider::Collider(const Type type, shared<Mesh> m, Transform* t, const vec3 d,
 // the work involved is too much to be worth it; use non-uniform colliders if and only if you know they don't depend on rotation,
 // e.g. a distended cube. Otherwise, your results will be inaccurate.
 void Collider::updateDims() {
-    const auto scale = _transform->getComputed()->scale();
+    const auto computed = _transform->getComputed();
+    const auto scale = computed.scale();
     _radius = maxf(maxf(_dims.x * scale.x, _dims.y * scale.y), _dims.z * scale.z);
     
     const auto factor = fudgeAABB ? 1.2f : 1.f;
-    const auto rot = _transform->getMats()->rotate;
+    const auto rot = quat::toMat3(computed.rotation());
     transformed_aabb.halfDims =  scale * factor * base_aabb.halfDims; // scaling is applied before rotation
 
     // applies the transformation R * (w,h,d) == R0 * w + R1 * h + R2 * d
@@ -39,8 +59,12 @@ void Collider::updateDims() {
                                    + abs(rot[2]) * transformed_aabb.halfDims.z);
 }
 
+// snapshots the transform for collision detection, which works on the colliders' local data and only transforms what it actually needs
 void Collider::update() {
-    _framePos = _transform->getComputed()->position();
+    const auto computed = _transform->getComputed();
+    _framePos   = computed.position();
+    _frameScale = computed.scale();
+    _frameRot   = quat::toMat3(computed.rotation());
     base_aabb.center = _framePos;
     transformed_aabb.center = base_aabb.center;
     
@@ -50,20 +74,153 @@ void Collider::update() {
     DrawDebug::get().drawDebugBox(transformed_aabb.center, transformed_aabb.halfDims.x * 2.f, transformed_aabb.halfDims.y * 2.f, transformed_aabb.halfDims.z * 2.f);
 }
 
+void Collider::moveFrame(const vec3 pos) {
+    _framePos = pos;
+    base_aabb.center = transformed_aabb.center = pos;
+}
+
+void Collider::getFacePlanes(std::vector<vec4>& planes) const {
+    // unlike getNormal, this accounts for non-uniform scale, as the planes have to actually contain the faces
+    for (size_t i = 0, numFaces = shape->faceNormals.size(); i < numFaces; ++i) {
+        const auto normal = glm::normalize(_frameRot * (shape->faceNormals[i] / _frameScale));
+        planes.push_back(vec4(normal, glm::dot(normal, getVert(shape->faceLoops[shape->faceLoopOffsets[i]]))));
+    }
+}
+
+// maps world space directions to the directions that give the same projections onto the untransformed verts, i.e. scale * inverse(rotation)
+mat3 Collider::getLocalDirMatrix() const {
+    auto m = glm::transpose(_frameRot);
+    for (auto i = 0; i < 3; ++i) m[i] *= _frameScale;
+    return m;
+}
+
 // gets the vertex of the collider furthest in the direction of dir
 SupportPoint Collider::getSupportPoint(const vec3 dir) {
-    auto& verts = getCurrVerts();
+    if (_type == Type::SPHERE) {
+        const auto len = glm::length(dir);
+        const auto point = len > FLT_EPSILON ? _framePos + dir * (_radius / len) : _framePos;
+        return { point, glm::dot(point, dir) };
+    }
+
+    const auto local = getLocalSupportPoint(getLocalDirMatrix() * dir);
+    return { toWorld(local.point), local.proj + glm::dot(_framePos, dir) };
+}
+
+// gets the untransformed vertex furthest in the direction of a local direction (see getLocalDirMatrix)
+SupportPoint Collider::getLocalSupportPoint(const vec3 dir) {
+    return shape->convex && shape->mesh->data().verts.size() >= HILL_CLIMB_MIN_VERTS ? getSupportPointHillClimb(dir) : getSupportPointLinear(dir);
+}
+
+// checks every vertex, 4 at a time where SSE is available
+SupportPoint Collider::getSupportPointLinear(const vec3 dir) {
+    auto& verts = shape->mesh->data().verts;
+    const auto numVerts = verts.size();
+
+    size_t best = 0, i = 0;
+    auto bestProj = glm::dot(verts[0], dir);
+
+#ifdef COLLIDER_SSE
+    if (numVerts >= 8) {
+        // the verts are packed xyz, so every 4 verts fill 3 registers; they're shuffled into x, y and z registers before the dot products
+        const auto dx = _mm_set1_ps(dir.x), dy = _mm_set1_ps(dir.y), dz = _mm_set1_ps(dir.z);
+        auto maxProj = _mm_set1_ps(-FLT_MAX);
+        auto maxIndex = _mm_setzero_si128(), index = _mm_setr_epi32(0, 1, 2, 3);
+        const auto four = _mm_set1_epi32(4);
+
+        const auto data = &verts[0].x;
+        for (; i + 4 <= numVerts; i += 4) {
+            const auto a = _mm_loadu_ps(data + i * 3)      // x0 y0 z0 x1
+                     , b = _mm_loadu_ps(data + i * 3 + 4)  // y1 z1 x2 y2
+                     , c = _mm_loadu_ps(data + i * 3 + 8); // z2 x3 y3 z3
+
+            const auto x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(3, 0, 3, 0));
+            const auto y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            const auto z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+            const auto proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, dx), _mm_mul_ps(y, dy)), _mm_mul_ps(z, dz));
+            const auto greater = _mm_cmpgt_ps(proj, maxProj);
+            maxProj  = _mm_or_ps(_mm_and_ps(greater, proj), _mm_andnot_ps(greater, maxProj));
+            maxIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(greater), index), _mm_andnot_si128(_mm_castps_si128(greater), maxIndex));
+            index = _mm_add_epi32(index, four);
+        }
+
+        alignas(16) float projs[4];
+        alignas(16) int32_t indices[4];
+        _mm_store_ps(projs, maxProj);
+        _mm_store_si128((__m128i*)indices, maxIndex);
+
+        // ties go to the lowest index, which matches the scalar scan
+        bestProj = projs[0]; best = indices[0];
+        for (auto lane = 1; lane < 4; ++lane) {
+            if (projs[lane] > bestProj || (projs[lane] == bestProj && (size_t)indices[lane] < best)) {
+                bestProj = projs[lane];
+                best = indices[lane];
+            }
+        }
+    }
+#endif
 
-    SupportPoint support{ verts[0], glm::dot(support.point, dir) };
-    for (size_t i = 1, numVerts = verts.size(); i < numVerts; ++i) {
-        const auto vert = verts[i];
-        const auto proj = glm::dot(vert, dir);
-        if (proj > support.proj) {
-            support.point = vert;
-            support.proj = proj;
+    for (; i < numVerts; ++i) {
+        const auto proj = glm::dot(verts[i], dir);
+        if (proj > bestProj) {
+            best = i;
+            bestProj = proj;
         }
     }
-    return support;
+    return { verts[best], bestProj };
+}
+
+/*
+----------------------------------------------------------------------
+- Walks the vertex adjacency graph from the last support point, moving to any neighbor further along dir until none are
+- A linear function over a convex hull has no local maxima besides the global one, so this finds the same point as a full scan
+  - This only holds for convex shapes with a connected graph, so it's only used for shapes that were checked to be (see ColliderShape::convex)
+  - Concave meshes, and ones with split vertices (e.g. for hard edges), use the linear scan instead, so they should be welded or hulled first
+- Successive queries tend to have similar directions, so starting from the last result usually takes only a few steps
+- Ties go to the lowest index, like the linear scan, so the result never depends on the starting point
+----------------------------------------------------------------------
+*/
+SupportPoint Collider::getSupportPointHillClimb(const vec3 dir) {
+    auto& verts = shape->mesh->data().verts;
+
+    GLuint curr = supportHint.object.load(std::memory_order_relaxed);
+    if (curr >= verts.size()) curr = 0;
+    auto currProj = glm::dot(verts[curr], dir);
+
+    for (auto climbing = true; climbing;) {
+        climbing = false;
+        for (auto i = shape->vertAdjOffsets[curr], end = shape->vertAdjOffsets[curr + 1]; i < end; ++i) {
+            const auto next = shape->vertAdjs[i];
+            const auto proj = glm::dot(verts[next], dir);
+            if (proj > currProj) {
+                curr = next;
+                currProj = proj;
+                climbing = true;
+            }
+        }
+    }
+
+    // the climb stops at whichever vert of a flat region it reaches first, so the region is searched for its lowest index instead;
+    // otherwise ties would depend on where the last query (possibly from another thread) left off, and so would the contacts
+    small_vector<GLuint, 16> flat; // only filled when there's a tie
+    for (auto i = shape->vertAdjOffsets[curr], end = shape->vertAdjOffsets[curr + 1]; i < end; ++i) {
+        if (glm::dot(verts[shape->vertAdjs[i]], dir) == currProj) {
+            flat.push_back(curr);
+            break;
+        }
+    }
+    for (size_t f = 0; f < flat.size(); ++f) {
+        const auto vert = flat[f];
+        curr = std::min(curr, vert);
+        for (auto i = shape->vertAdjOffsets[vert], end = shape->vertAdjOffsets[vert + 1]; i < end; ++i) {
+            const auto next = shape->vertAdjs[i];
+            if (glm::dot(verts[next], dir) == currProj && std::find(flat.begin(), flat.end(), next) == flat.end())
+                flat.push_back(next);
+        }
+    }
+
+    supportHint.object.store(curr, std::memory_order_relaxed);
+    return { verts[curr], currProj };
 }
 
 /*
@@ -74,6 +231,9 @@ SupportPoint Collider::getSupportPoint(const vec3 dir) {
   so the greatest NEGATIVE value has the least penetration
 
 - If the value is positive, then there is no penetration i.e. there is a separating axis
+
+- This works in this collider's space (rotated, but not scaled), so the normals are used as is
+  - Only the direction of each query on the other collider needs to be transformed, and the support points stay in its local space
 ----------------------------------------------------------------------
 */
 FaceManifold Collider::getAxisMinPen(Collider* other) {
@@ -82,24 +242,26 @@ FaceManifold Collider::getAxisMinPen(Collider* other) {
     axis.originator = this;
     axis.other = other;
 
-    auto& meshVerts = getCurrVerts();
-    auto& faceVerts = mesh->indices().verts;
-    auto& normals = getCurrNormals();
+    auto& meshVerts = shape->mesh->data().verts;
+
+    const auto toOther = other->getLocalDirMatrix() * _frameRot;
+    const auto otherPos = glm::transpose(_frameRot) * (other->framePos() - _framePos);
 
-    for (size_t i = 0, numAxes = normals.size(); axis.pen < PEN_TOLERANCE && i < numAxes; ++i) {
-        const auto norm = normals[i];
-        const auto support = other->getSupportPoint(-norm);
-        const auto vert = meshVerts[faceVerts[i * 3]]; // some vert from the face corresponding to the normal
+    for (size_t i = 0, numAxes = shape->faceNormals.size(); axis.pen < PEN_TOLERANCE && i < numAxes; ++i) {
+        const auto norm = shape->faceNormals[i];
+        const auto support = other->getLocalSupportPoint(toOther * -norm);
+        const auto vert = _frameScale * meshVerts[shape->faceLoops[shape->faceLoopOffsets[i]]]; // some vert from the face corresponding to the normal
 
         // point-plane signed distance, negative if penetrating, positive if not
-        const auto pen = glm::dot(norm, support.point - vert);
+        // the support point's projection onto the normal is split into the other collider's position and the (negated) local projection
+        const auto pen = glm::dot(norm, otherPos - vert) - support.proj;
         if (pen > axis.pen) {
             axis.norm = i;
             axis.pen = pen;
         }
     }
 
-    if (axis.pen > -FLT_MAX) axis.axis = normals[axis.norm];
+    if (axis.pen > -FLT_MAX) axis.axis = _frameRot * shape->faceNormals[axis.norm];
     return axis;
 }
 
@@ -139,6 +301,9 @@ such that N(p) is a normal to X at point p. The only requirement is that X is or
 - Face normals can be tested as they would normally, and should be tested before overlaying the gauss maps, as it requires fewer comparisons.
   (though the necessity of the support points may offset this)
 - Incidentally, overlaying Gauss maps is also referred to as checking for Voronoi region overlap.
+- Like the face tests, this works in this collider's space; the other collider's normals are transformed once per arc,
+  while its edges and verts are only transformed for arcs that actually intersect
+- This collider's arcs are stored as flat component arrays with their plane normals precomputed, so with SSE they're tested 4 at a time
 - I recommend http://twvideo01.ubm-us.net/o1/vault/gdc2013/slides/822403Gregorius_Dirk_TheSeparatingAxisTest.pdf if you're interested in reading more on this technique,
   as this is where most of my research originates.
 ------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -148,84 +313,132 @@ EdgeManifold Collider::overlayGaussMaps(Collider* other) {
     manifold.originator = this;
     manifold.other = other;
 
-    auto& verts = getCurrVerts();
-    auto& otherVerts = other->getCurrVerts();
-
-    auto& normals = getCurrNormals();
-    auto& otherNormals = other->getCurrNormals();
+    auto& verts = shape->mesh->data().verts;
+    auto& otherVerts = other->shape->mesh->data().verts;
 
+    auto& gauss = shape->gauss;
     auto& othergauss = other->getGaussMap();
 
-    for (const auto& pair : gauss.adjacencies) {
-        for (const auto curr : pair.second) {
-
-            const auto a = normals[curr.faces.first], b = normals[curr.faces.second];
-            const auto bxa = glm::cross(b, a);
-
-            for (const auto& otherPair : othergauss.adjacencies) {
-                for (const auto otherCurr : otherPair.second) {
-
-                    // these must be negative to account for the Minkowski DIFFERENCE
-                    // however, that's more expensive than negating on demand, so that's what we'll do
-                    const auto c = otherNormals[otherCurr.faces.first], d = otherNormals[otherCurr.faces.second];
-
-                    // checks if the arcs between arc(a,b) and arc(c,d) intersect
-                    const bfloat cba{ -glm::dot(c, bxa) }
-                               , dba{ -glm::dot(d, bxa) }; // negate for MD
-
-                    // if c and d are on different sides of arc BA
-                    // test with whether the signs or different or either is 0
-                    // bitwise ops and int to bool ends up being faster than the multiplication
-                    // if (CBA * DBA < 0) {
-                    if (cba.i && dba.i && (cba.i ^ dba.i) < 0) {
-
-                        const auto dxc = glm::cross(d, c); // the MD negations cancel out here
-                        const bfloat adc{ glm::dot(a, dxc) }
-                                   , bdc{ glm::dot(b, dxc) };
-
-                        // if a and b are on different sides of arc DC &&
-                        // if a and d are on the same side of the plane formed by b and c (c . (b x a) * b . (d x c) > 0)
-                        // (this works because a . (b x c) == c . (b x a) and d . (b x c) == b . (d x c))(scalar triple product identity)
-                        // [scalar triple product of a,b,c == [ABC] = a . (b x c)]
-                        // same principle as previous
-                        // if (ADC * BDC < 0 && CBA * BDC > 0) {
-                        if (adc.i && bdc.i && (adc.i ^ bdc.i) < 0 && (cba.i ^ bdc.i) > 0) {
-                            const auto edge      = getEdge(curr.edge), 
-                                       otherEdge = other->getEdge(otherCurr.edge);
-
-                            // if edges are parallel, we don't care since they don't define a plane
-                            if (fuzzyParallel(edge, otherEdge)) continue;
-
-                            const auto v1 = verts[curr.edge.first()],
-                                       v2 = otherVerts[otherCurr.edge.first()];
-
-                            // check distance from plane defined by edge normal and one vertex on this body's edge
-                            auto edgeNormal = glm::normalize(glm::cross(edge, otherEdge));
-                            edgeNormal *= signf(glm::dot(edgeNormal, v1 - _framePos)); // make sure the edge normal is facing outwards from the body
-
-                            const auto pen = glm::dot(edgeNormal, v2 - v1); // does this work regardless of the edges' points used?
-                            if (pen > manifold.pen) {
-                                manifold.edgePair = { curr, otherCurr };
-                                manifold.pen = pen;
-                                manifold.axis = edgeNormal;
-                                // we found a separating axis boys
-                                if (manifold.pen > PEN_TOLERANCE) return manifold;
-                            }
-                        }
-
-                    } // end edge culling
+    // the other collider's rotation and position relative to this one
+    const auto otherRot = glm::transpose(_frameRot) * other->frameRot();
+    const auto otherPos = glm::transpose(_frameRot) * (other->framePos() - _framePos);
 
-                }
-            } // end other gauss loop
+    // tests the edges of a pair of intersecting arcs, returning true if they form a separating axis
+    const auto testEdges = [&](const Adj& curr, const Adj& otherCurr) {
+        const auto edge      = getLocalEdge(curr.edge), 
+                   otherEdge = otherRot * other->getLocalEdge(otherCurr.edge);
+
+        // if edges are parallel, we don't care since they don't define a plane
+        if (fuzzyParallel(edge, otherEdge)) return false;
 
+        const auto v1 = _frameScale * verts[curr.edge.first()],
+                   v2 = otherPos + otherRot * (other->frameScale() * otherVerts[otherCurr.edge.first()]);
+
+        // check distance from plane defined by edge normal and one vertex on this body's edge
+        auto edgeNormal = glm::normalize(glm::cross(edge, otherEdge));
+        edgeNormal *= signf(glm::dot(edgeNormal, v1)); // make sure the edge normal is facing outwards from the body
+
+        const auto pen = glm::dot(edgeNormal, v2 - v1); // does this work regardless of the edges' points used?
+        if (pen > manifold.pen) {
+            manifold.edgePair = { curr, otherCurr };
+            manifold.pen = pen;
+            manifold.axis = _frameRot * edgeNormal;
+            // we found a separating axis boys
+            if (manifold.pen > PEN_TOLERANCE) return true;
         }
-    } // end gauss loop
+        return false;
+    };
+
+    for (size_t j = 0, numOtherArcs = othergauss.size(); j < numOtherArcs; ++j) {
+        // these must be negative to account for the Minkowski DIFFERENCE
+        // however, that's more expensive than negating on demand, so that's what we'll do
+        const auto c = otherRot * othergauss.a[j], d = otherRot * othergauss.b[j];
+        const auto dxc = glm::cross(d, c); // the MD negations cancel out here
+        const auto& otherCurr = othergauss.adjs[j];
+
+#ifdef COLLIDER_SSE
+        // the same tests as below, on 4 of this collider's arcs at once; the sign tests are done on the raw bits just like bfloat
+        const auto cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+        const auto dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+        const auto dxcx = _mm_set1_ps(dxc.x), dxcy = _mm_set1_ps(dxc.y), dxcz = _mm_set1_ps(dxc.z);
+        const auto signBit = _mm_set1_ps(-0.f);
+        const auto zero = _mm_setzero_si128();
+
+        const auto dot = [](__m128 x0, __m128 y0, __m128 z0, __m128 x1, __m128 y1, __m128 z1) {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)), _mm_mul_ps(z0, z1));
+        };
+        const auto nonZero = [zero](__m128i v) { return _mm_xor_si128(_mm_cmpeq_epi32(v, zero), _mm_set1_epi32(-1)); };
+        const auto signsDiffer = [](__m128i u, __m128i v) { return _mm_srai_epi32(_mm_xor_si128(u, v), 31); };
+
+        for (size_t i = 0, paddedArcs = gauss.a.size(); i < paddedArcs; i += GaussMap::WIDTH) {
+            const auto nx = _mm_loadu_ps(&gauss.bxa.x[i]), ny = _mm_loadu_ps(&gauss.bxa.y[i]), nz = _mm_loadu_ps(&gauss.bxa.z[i]);
+            const auto cba = _mm_castps_si128(_mm_xor_ps(dot(cx, cy, cz, nx, ny, nz), signBit))
+                     , dba = _mm_castps_si128(_mm_xor_ps(dot(dx, dy, dz, nx, ny, nz), signBit)); // negate for MD
+
+            auto mask = _mm_and_si128(_mm_and_si128(nonZero(cba), nonZero(dba)), signsDiffer(cba, dba));
+            if (!_mm_movemask_epi8(mask)) continue;
+
+            const auto adc = _mm_castps_si128(dot(_mm_loadu_ps(&gauss.a.x[i]), _mm_loadu_ps(&gauss.a.y[i]), _mm_loadu_ps(&gauss.a.z[i]), dxcx, dxcy, dxcz))
+                     , bdc = _mm_castps_si128(dot(_mm_loadu_ps(&gauss.b.x[i]), _mm_loadu_ps(&gauss.b.y[i]), _mm_loadu_ps(&gauss.b.z[i]), dxcx, dxcy, dxcz));
+
+            mask = _mm_and_si128(mask, _mm_and_si128(_mm_and_si128(nonZero(adc), nonZero(bdc)), signsDiffer(adc, bdc)));
+            mask = _mm_and_si128(mask, _mm_cmpgt_epi32(_mm_xor_si128(cba, bdc), zero));
+
+            // padding arcs fail the tests, so every set lane is a real arc; they're tested in order, same as the scalar loop
+            const auto lanes = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            for (size_t lane = 0; lane < GaussMap::WIDTH; ++lane) {
+                if ((lanes & (1 << lane)) && testEdges(gauss.adjs[i + lane], otherCurr)) return manifold;
+            }
+        }
+#else
+        for (size_t i = 0, numArcs = gauss.size(); i < numArcs; ++i) {
+            const auto a = gauss.a[i], b = gauss.b[i];
+            const auto bxa = gauss.bxa[i];
+
+            // checks if the arcs between arc(a,b) and arc(c,d) intersect
+            const bfloat cba{ -glm::dot(c, bxa) }
+                       , dba{ -glm::dot(d, bxa) }; // negate for MD
+
+            // if c and d are on different sides of arc BA
+            // test with whether the signs or different or either is 0
+            // bitwise ops and int to bool ends up being faster than the multiplication
+            // (the bits are unsigned, so they have to be cast to test the sign of the xor)
+            // if (CBA * DBA < 0) {
+            if (!(cba.i && dba.i && (int32_t)(cba.i ^ dba.i) < 0)) continue;
+
+            const bfloat adc{ glm::dot(a, dxc) }
+                       , bdc{ glm::dot(b, dxc) };
+
+            // if a and b are on different sides of arc DC &&
+            // if a and d are on the same side of the plane formed by b and c (c . (b x a) * b . (d x c) > 0)
+            // (this works because a . (b x c) == c . (b x a) and d . (b x c) == b . (d x c))(scalar triple product identity)
+            // [scalar triple product of a,b,c == [ABC] = a . (b x c)]
+            // same principle as previous
+            // if (ADC * BDC < 0 && CBA * BDC > 0) {
+            if (adc.i && bdc.i && (int32_t)(adc.i ^ bdc.i) < 0 && (int32_t)(cba.i ^ bdc.i) > 0) {
+                if (testEdges(gauss.adjs[i], otherCurr)) return manifold;
+            }
+        }
+#endif
+    }
     return manifold;
 }
 
 // Colliders assume their meshes are centered at the origin; if they aren't there will be inaccuracy
 // we return a valid manifold, or if there was no collision one with a nullptr originator
-Manifold Collider::intersects(Collider* other) {
+// this only reads data that's fixed until the colliders are next updated, so it can run on any thread; it must not draw debug primitives
+Manifold Collider::intersects(Collider* other, SeparatingAxis* lastAxis) {
+    return intersects(other, getPairMethod(other), lastAxis);
+}
+
+Manifold Collider::intersects(Collider* other, Method method, SeparatingAxis* lastAxis) {
+
+    // spheres and boxes have exact routines, which are much cheaper than either general method
+    const auto otherType = other->type();
+    if (_type == Type::SPHERE && otherType == Type::SPHERE) return intersectsSpheres(other);
+    if (_type == Type::BOX    && otherType == Type::BOX)    return intersectsBoxes(other);
+    if (_type == Type::BOX    && otherType == Type::SPHERE) return intersectsBoxSphere(other);
+    if (_type == Type::SPHERE && otherType == Type::BOX)    return other->intersectsBoxSphere(this);
 
     // quick sphere collision optimization
     const auto d = _framePos - other->framePos(); // ignores displaced colliders
@@ -234,11 +447,239 @@ Manifold Collider::intersects(Collider* other) {
     if (distSq > rad * rad)
         return Manifold();
 
+    // spheres don't have any faces or edges for SAT to test
+    if (method == Method::GJK || _type == Type::SPHERE || otherType == Type::SPHERE)
+        return intersectsGJK(other);
+    return intersectsSAT(other, lastAxis);
+}
+
+Manifold Collider::intersectsSpheres(Collider* other) {
+    const auto d = other->framePos() - _framePos;
+    const auto dist = glm::length(d);
+    const auto pen = dist - (_radius + other->radius());
+    if (pen > PEN_TOLERANCE)
+        return Manifold();
+
+    Manifold m;
+    m.originator = this;
+    m.other = other;
+    m.pen = pen;
+    m.axis = dist > FLT_EPSILON ? d / dist : vec3(0, 1, 0); // concentric spheres can be pushed apart in any direction
+    m.colPoints.push_back(_framePos + m.axis * (_radius + pen * 0.5f)); // the middle of the overlap
+    return m;
+}
+
+namespace {
+    // a box collider in world space
+    struct OBB {
+        vec3 center, axes[3], halfDims;
+        OBB(const Collider* c) : center(c->framePos()), axes{ c->frameRot()[0], c->frameRot()[1], c->frameRot()[2] }, halfDims(c->dims() * c->frameScale()) {}
+
+        // the radius of the box's projection onto an axis
+        float project(const vec3 axis) const {
+            return halfDims.x * std::abs(glm::dot(axes[0], axis))
+                 + halfDims.y * std::abs(glm::dot(axes[1], axis))
+                 + halfDims.z * std::abs(glm::dot(axes[2], axis));
+        }
+    };
+}
+
+// this collider is the box; the axis points from the box to the sphere
+Manifold Collider::intersectsBoxSphere(Collider* sphere) {
+    const OBB box(this);
+    const auto center = sphere->framePos();
+    const auto offset = center - box.center;
+
+    // the closest point on the box to the sphere's center, in the box's axes
+    vec3 closest;
+    auto inside = true;
+    for (auto k = 0; k < 3; ++k) {
+        const auto d = glm::dot(offset, box.axes[k]);
+        closest[k] = glm::clamp(d, -box.halfDims[k], box.halfDims[k]);
+        inside &= closest[k] == d;
+    }
+
+    Manifold m;
+    m.originator = this;
+    m.other = sphere;
+
+    if (inside) {
+        // the center is inside the box, so it has to be pushed out through the nearest face
+        auto face = 0;
+        for (auto k = 1; k < 3; ++k) {
+            if (box.halfDims[k] - std::abs(closest[k]) < box.halfDims[face] - std::abs(closest[face])) face = k;
+        }
+        const auto sign = closest[face] < 0 ? -1.f : 1.f;
+        m.pen = -(box.halfDims[face] - std::abs(closest[face])) - sphere->radius();
+        m.axis = box.axes[face] * sign;
+        closest[face] = sign * box.halfDims[face];
+    }
+    else {
+        const auto diff = offset - (box.axes[0] * closest.x + box.axes[1] * closest.y + box.axes[2] * closest.z);
+        const auto dist = glm::length(diff);
+        m.pen = dist - sphere->radius();
+        m.axis = diff / dist;
+    }
+    if (m.pen > PEN_TOLERANCE)
+        return Manifold();
+
+    m.colPoints.push_back(box.center + box.axes[0] * closest.x + box.axes[1] * closest.y + box.axes[2] * closest.z);
+    return m;
+}
+
+/*
+----------------------------------------------------------------------
+- SAT specialized for boxes: only the 3 face axes of each box and the 9 cross products of their axes need to be tested,
+  and the projections onto each axis can be computed directly from the half dimensions
+- Edge axes have to be noticeably better than the best face axis to be chosen,
+  as face contacts give full manifolds and nearly parallel edges can flip back and forth between frames
+- Face contacts clip the incident face (the face on the other box most anti-parallel to the reference face) against the reference face's sides
+- Edge contacts use the closest point between the edges of each box furthest along the axis
+----------------------------------------------------------------------
+*/
+Manifold Collider::intersectsBoxes(Collider* other) {
+    constexpr float EDGE_BIAS = 0.01f;
+    const OBB A(this), B(other);
+    const auto t = B.center - A.center;
+
+    enum class AxisType { FACE_A, FACE_B, EDGE };
+    struct { vec3 axis; float pen = -FLT_MAX; AxisType type = AxisType::FACE_A; int i = 0, j = 0; } best;
+
+    // returns false if the axis separates the boxes
+    const auto test = [&](const vec3 axis, AxisType type, int i, int j, float bias) {
+        const auto dist = glm::dot(t, axis);
+        const auto pen = std::abs(dist) - (A.project(axis) + B.project(axis));
+        if (pen > PEN_TOLERANCE) return false;
+        if (pen > best.pen + bias) {
+            best.axis = dist < 0 ? -axis : axis; // facing from this box to the other
+            best.pen = pen;
+            best.type = type;
+            best.i = i;
+            best.j = j;
+        }
+        return true;
+    };
+
+    for (auto i = 0; i < 3; ++i) {
+        if (!test(A.axes[i], AxisType::FACE_A, i, 0, 0)) return Manifold();
+    }
+    for (auto j = 0; j < 3; ++j) {
+        if (!test(B.axes[j], AxisType::FACE_B, j, 0, 0)) return Manifold();
+    }
+    for (auto i = 0; i < 3; ++i) {
+        for (auto j = 0; j < 3; ++j) {
+            const auto axis = glm::cross(A.axes[i], B.axes[j]);
+            const auto len = glm::length(axis);
+            if (len < 0.0001f) continue; // parallel edges are covered by the face axes
+            if (!test(axis / len, AxisType::EDGE, i, j, EDGE_BIAS)) return Manifold();
+        }
+    }
+
+    Manifold m;
+    m.pen = best.pen;
+
+    if (best.type == AxisType::EDGE) {
+        m.originator = this;
+        m.other = other;
+        m.axis = best.axis;
+
+        // moves from the centers to the edges closest to the other box, tracking which of the 4 parallel edges it is
+        auto pA = A.center, pB = B.center;
+        GLuint edgeA = best.i * 4, edgeB = best.j * 4;
+        for (auto k = 0, bit = 0; k < 3; ++k) {
+            if (k == best.i) continue;
+            const auto sign = glm::dot(A.axes[k], m.axis) < 0 ? -1.f : 1.f;
+            pA += A.axes[k] * (A.halfDims[k] * sign);
+            edgeA |= (sign > 0) << bit++;
+        }
+        for (auto k = 0, bit = 0; k < 3; ++k) {
+            if (k == best.j) continue;
+            const auto sign = glm::dot(B.axes[k], m.axis) < 0 ? 1.f : -1.f;
+            pB += B.axes[k] * (B.halfDims[k] * sign);
+            edgeB |= (sign > 0) << bit++;
+        }
+
+        const auto eA = A.axes[best.i] * A.halfDims[best.i], eB = B.axes[best.j] * B.halfDims[best.j];
+        m.colPoints.push_back(closestPointBtwnSegments(pA - eA, pA + eA, pB - eB, pB + eB));
+        m.feature.type = ContactFeature::Type::EDGE;
+        m.feature.edges[0] = Edge(edgeA, edgeA);
+        m.feature.edges[1] = Edge(edgeB, edgeB);
+        return m;
+    }
+
+    const auto refIsA = best.type == AxisType::FACE_A;
+    const auto& ref = refIsA ? A : B;
+    const auto& inc = refIsA ? B : A;
+    const auto face = best.i;
+
+    m.originator = refIsA ? this : other;
+    m.other = refIsA ? other : this;
+    m.axis = refIsA ? best.axis : -best.axis; // facing from the reference box to the incident box
+
+    auto incFace = 0;
+    for (auto k = 1; k < 3; ++k) {
+        if (std::abs(glm::dot(inc.axes[k], m.axis)) > std::abs(glm::dot(inc.axes[incFace], m.axis))) incFace = k;
+    }
+    const auto incNormal = inc.axes[incFace] * -signf(glm::dot(inc.axes[incFace], m.axis));
+    const auto incCenter = inc.center + incNormal * inc.halfDims[incFace];
+    const auto u = inc.axes[(incFace + 1) % 3] * inc.halfDims[(incFace + 1) % 3]
+             , v = inc.axes[(incFace + 2) % 3] * inc.halfDims[(incFace + 2) % 3];
+
+    // the polygon is clipped back and forth between two buffers
+    Polygon buffers[2] = { { incCenter + u + v, incCenter - u + v, incCenter - u - v, incCenter + u - v } };
+    auto clipped = &buffers[0], scratch = &buffers[1];
+    const auto refCenter = ref.center + m.axis * ref.halfDims[face];
+    for (auto side = 1; side < 3 && clipped->size(); ++side) {
+        const auto k = (face + side) % 3;
+        for (const auto sign : { 1.f, -1.f }) {
+            const auto sideNormal = ref.axes[k] * sign;
+            clipPolyAgainstEdge(*clipped, *scratch, sideNormal, ref.center + sideNormal * ref.halfDims[k], m.axis, refCenter);
+            std::swap(clipped, scratch);
+        }
+    }
+
+    // clipping can lose every point when the faces are barely touching, so fall back to the deepest corner
+    if (clipped->empty()) {
+        auto corner = inc.center;
+        for (auto k = 0; k < 3; ++k) corner -= inc.axes[k] * (inc.halfDims[k] * signf(glm::dot(inc.axes[k], m.axis)));
+        clipped->push_back(corner);
+    }
+
+    m.colPoints.insert(clipped->begin(), clipped->end());
+    m.feature.type = ContactFeature::Type::FACE;
+    m.feature.face = face * 2 + (glm::dot(ref.axes[face], m.axis) < 0);
+    return m;
+}
+
+// uses GJK to check for overlap, then EPA to find the penetration; this only produces a single contact point
+Manifold Collider::intersectsGJK(Collider* other) {
+    GJK::Simplex simplex;
+    if (!GJK::intersects(this, other, simplex))
+        return Manifold();
+
+    auto m = GJK::penetration(this, other, simplex);
+    if (m.pen > PEN_TOLERANCE)
+        return Manifold();
+    return m;
+}
+
+Manifold Collider::intersectsSAT(Collider* other, SeparatingAxis* lastAxis) {
+
+    // colliders that are near each other but not touching tend to stay that way for a while,
+    // and the axis that separated them last time is almost always still a separating axis
+    if (lastAxis && separates(other, *lastAxis))
+        return Manifold();
+
+    SeparatingAxis foundAxis;
+
     // separating axis theorem 2: electric boogaloo
     // axis of min pen on this collider
     auto minAxis = getAxisMinPen(other);
     if (minAxis.pen > PEN_TOLERANCE) {
         //std::cout << "This: " << minAxis.pen << "; " << minAxis.axis.x << ", " << minAxis.axis.y << ", " << minAxis.axis.z << '\n';
+        foundAxis.type = SeparatingAxis::Type::FACE;
+        foundAxis.face = minAxis.norm;
+        if (lastAxis) *lastAxis = foundAxis;
         return Manifold();
     }
 
@@ -246,28 +687,30 @@ Manifold Collider::intersects(Collider* other) {
     auto otherMinAxis = other->getAxisMinPen(this);
     if (otherMinAxis.pen > PEN_TOLERANCE) {
         //std::cout << "Other: " << otherMinAxis.pen << "; " << otherMinAxis.axis.x << ", " << otherMinAxis.axis.y << ", " << otherMinAxis.axis.z << '\n';
+        foundAxis.type = SeparatingAxis::Type::OTHER_FACE;
+        foundAxis.face = otherMinAxis.norm;
+        if (lastAxis) *lastAxis = foundAxis;
         return Manifold();
     }
 
     // closest penetrating edges on both colliders
     auto minEdge = overlayGaussMaps(other);
     if (minEdge.pen > PEN_TOLERANCE) {
-        // debug code
-        const auto  v1  = getVert(minEdge.edgePair.first.edge.first())
-                  , v2  = getVert(minEdge.edgePair.first.edge.second())
-                  , ov1 = other->getVert(minEdge.edgePair.second.edge.first())
-                  , ov2 = other->getVert(minEdge.edgePair.second.edge.second());
-        DrawDebug::get().drawDebugVector(v1, v2, vec3(1, 0, 0));
-        DrawDebug::get().drawDebugVector(ov1, ov2, vec3(1, 1, 0));
         //std::cout << "Edge: " << minEdge.pen << '\n';
+        foundAxis.type = SeparatingAxis::Type::EDGE;
+        foundAxis.edges[0] = minEdge.edgePair.first.edge;
+        foundAxis.edges[1] = minEdge.edgePair.second.edge;
+        if (lastAxis) *lastAxis = foundAxis;
         return Manifold();
     }
 
+    // the colliders are touching, so there's nothing worth remembering
+    if (lastAxis) *lastAxis = foundAxis;
+
     auto& minFace = (minAxis.pen > otherMinAxis.pen) ? minAxis : otherMinAxis;
 
     // edge-edge collision
     if (minEdge.pen > minFace.pen) {
-        std::cout << "EDGE ";
         // get the points defining both edges in the collision in world space
         const auto p0 = getVert(minEdge.edgePair.first.edge.first())
                  , p1 = getVert(minEdge.edgePair.first.edge.second())
@@ -276,7 +719,9 @@ Manifold Collider::intersects(Collider* other) {
 
         // find the closest point between the two edges
         minEdge.colPoints.push_back(closestPointBtwnSegments(p0, p1, q0, q1));
-        DrawDebug::get().drawDebugSphere(minEdge.colPoints[0], 0.2f, vec3(0,1,0), 0.8f);
+        minEdge.feature.type = ContactFeature::Type::EDGE;
+        minEdge.feature.edges[0] = minEdge.edgePair.first.edge;
+        minEdge.feature.edges[1] = minEdge.edgePair.second.edge;
         return minEdge;
     }
     // face-* collision
@@ -288,19 +733,55 @@ Manifold Collider::intersects(Collider* other) {
 
         // clip the incident face(s) against the reference face
         minFace.originator->clipPolygons(minFace, incidents);
+        minFace.feature.type = ContactFeature::Type::FACE;
+        minFace.feature.face = minFace.norm;
+        return minFace;
+    }
+}
 
-        for (const auto& colPoint : minFace.colPoints)
-            DrawDebug::get().drawDebugSphere(colPoint, 0.1f, vec3(1,0,0), 0.8f);
+Collider::Method Collider::typeMethods[] = { Method::SAT, Method::SAT, Method::SAT };
 
-        return minFace;
+void Collider::setTypeMethod(const Type type, const Method method) { typeMethods[(size_t)type] = method; }
+Collider::Method Collider::getTypeMethod(const Type type) { return typeMethods[(size_t)type]; }
+
+Collider::Method Collider::getPairMethod(const Collider* other) const {
+    return getTypeMethod(_type) == Method::GJK && getTypeMethod(other->type()) == Method::GJK ? Method::GJK : Method::SAT;
+}
+
+// checks whether a previously found separating axis still separates the colliders, using their current orientations
+bool Collider::separates(Collider* other, const SeparatingAxis& axis) {
+    switch (axis.type) {
+    case SeparatingAxis::Type::FACE:
+        return getSeparation(other, getNormal(axis.face)) > PEN_TOLERANCE;
+    case SeparatingAxis::Type::OTHER_FACE:
+        return other->getSeparation(this, other->getNormal(axis.face)) > PEN_TOLERANCE;
+    case SeparatingAxis::Type::EDGE: {
+        const auto edge = getEdge(axis.edges[0]), otherEdge = other->getEdge(axis.edges[1]);
+        // the edges may have rotated into being parallel since, in which case they no longer define an axis
+        if (fuzzyParallel(edge, otherEdge)) return false;
+
+        auto edgeNormal = glm::normalize(glm::cross(edge, otherEdge));
+        edgeNormal *= signf(glm::dot(edgeNormal, other->framePos() - _framePos)); // point it towards the other collider
+        return getSeparation(other, edgeNormal) > PEN_TOLERANCE;
     }
+    default:
+        return false;
+    }
+}
+
+// the distance between the colliders' projections onto an axis pointing from this collider towards the other; negative if they overlap
+// unlike the values found during SAT, this holds for any axis, not just the ones defined by the colliders' features
+float Collider::getSeparation(Collider* other, const vec3 axis) {
+    return -other->getSupportPoint(-axis).proj - getSupportPoint(axis).proj;
 }
 
 // Gets the indices of the faces on this body that are most anti-parallel to the reference normal
-std::vector<GLuint> Collider::getIncidentFaces(const vec3 refNormal) {
-    std::vector<GLuint> faces;
-    auto& normals = getCurrNormals();
+Collider::FaceList Collider::getIncidentFaces(const vec3 worldRefNormal) {
+    FaceList faces;
+    auto& normals = shape->faceNormals;
 
+    // the projections are the same in local space, and this way only the reference normal is transformed
+    const auto refNormal = glm::transpose(_frameRot) * worldRefNormal;
     auto antiProj = glm::dot(normals[0], refNormal);
     faces.push_back(0);
     for (size_t i = 1, numFaces = normals.size(); i < numFaces; ++i) {
@@ -333,13 +814,14 @@ std::vector<GLuint> Collider::getIncidentFaces(const vec3 refNormal) {
 - http://gamedevelopment.tutsplus.com/tutorials/understanding-sutherland-hodgman-clipping-for-physics-engines--gamedev-11917
 ------------------------------------------------------------------------------------------------------------------------------------
 */
-void Collider::clipPolygons(FaceManifold& reference, const std::vector<GLuint>& incidents) {
+void Collider::clipPolygons(FaceManifold& reference, const FaceList& incidents) {
 
     // get the transformed center point of the reference face
-    auto& vertFaces = mesh->indices().verts;
-    const auto index = reference.norm * 3;
-    auto refCenter = getVert(vertFaces[index]) + getVert(vertFaces[index + 1]) + getVert(vertFaces[index + 2]);
-    refCenter /= 3.f;
+    const auto refBegin = shape->faceLoopOffsets[reference.norm], refEnd = shape->faceLoopOffsets[reference.norm + 1];
+    vec3 refCenter;
+    for (auto i = refBegin; i < refEnd; ++i)
+        refCenter += getVert(shape->faceLoops[i]);
+    refCenter /= (float)(refEnd - refBegin);
 
     struct plane { vec3 normal, vert; };
     plane refFace{ reference.axis, refCenter };
@@ -350,13 +832,11 @@ void Collider::clipPolygons(FaceManifold& reference, const std::vector<GLuint>&
     // These are supposed to be the normals of the faces adjacent to the reference face, at least according to Bullet
     // I use the actual side planes of the face, 
     // i.e. normals from the edges perpendicular to the edge and face normal facing outward from the face's center
-    std::vector<plane> sidePlanes;
-    sidePlanes.reserve(3);
+    small_vector<plane, 32> sidePlanes;
 
-    for (auto i = 0; i < 3; ++i) {
-        auto& v = vertFaces[reference.norm * 3 + i];
-        const auto vert = getVert(v)
-                 , edge = getEdge({ v, vertFaces[reference.norm * 3 + (i + 1) % 3] });
+    for (auto i = refBegin; i < refEnd; ++i) {
+        const auto vert = getVert(shape->faceLoops[i])
+                 , edge = getVert(shape->faceLoops[i + 1 < refEnd ? i + 1 : refBegin]) - vert;
 
         auto norm = glm::cross(reference.axis, edge);
         norm *= signf(glm::dot(norm, vert - refCenter));
@@ -367,22 +847,22 @@ void Collider::clipPolygons(FaceManifold& reference, const std::vector<GLuint>&
         //DrawDebug::get().drawDebugVector(vert, vert + norm, vec3(1, 0, 1));
     }
 
+    // each incident face is clipped back and forth between two buffers
+    const auto other = reference.other;
+    Polygon buffers[2];
     for (const auto incidentFace : incidents) {
+        auto clipped = &buffers[0], scratch = &buffers[1];
+        clipped->clear();
+        for (auto i = other->shape->faceLoopOffsets[incidentFace], last = other->shape->faceLoopOffsets[incidentFace + 1]; i < last; ++i)
+            clipped->push_back(other->getVert(other->shape->faceLoops[i]));
 
-        std::vector<vec3> incidentVerts = {
-            reference.other->getVert(reference.other->getFaceVert(incidentFace * 3)),
-            reference.other->getVert(reference.other->getFaceVert(incidentFace * 3 + 1)),
-            reference.other->getVert(reference.other->getFaceVert(incidentFace * 3 + 2))
-        };
-
-        auto clipped = incidentVerts;
-        for (auto s = 0; s < 3 && clipped.size(); ++s) {
+        for (size_t s = 0, numSides = sidePlanes.size(); s < numSides && clipped->size(); ++s) {
             auto& plane = sidePlanes[s];
-            clipped = clipPolyAgainstEdge(clipped, plane.normal, plane.vert, refFace.normal, refFace.vert);
+            clipPolyAgainstEdge(*clipped, *scratch, plane.normal, plane.vert, refFace.normal, refFace.vert);
+            std::swap(clipped, scratch);
         }
 
-        reference.colPoints.reserve(reference.colPoints.size() + clipped.size());
-        reference.colPoints.insert(end(reference.colPoints), begin(clipped), end(clipped));
+        reference.colPoints.insert(clipped->begin(), clipped->end());
     }
 }
 
@@ -421,11 +901,11 @@ void Collider::clipPolygons(FaceManifold& reference, const std::vector<GLuint>&
 - We call this using thick planes, rather than planes of indeterminably small thickness which is what we normally use
 ------------------------------------------------------------------------------------------------------------------------------------
 */
-std::vector<vec3> Collider::clipPolyAgainstEdge(std::vector<vec3>& input, const vec3 sideNormal, const vec3 sideVert, const vec3 refNorm, const vec3 refCenter) const {
-    std::vector<vec3> output;
+void Collider::clipPolyAgainstEdge(const Polygon& input, Polygon& output, const vec3 sideNormal, const vec3 sideVert, const vec3 refNorm, const vec3 refCenter) const {
+    output.clear();
 
     // regular conditions protect against this, but just to be safe
-    if (input.empty()) return output;
+    if (input.empty()) return;
 
     vec3 startpt = input.back(), endpt;
     for (size_t i = 0, numInputs = input.size(); i < numInputs; ++i, startpt = endpt) {
@@ -457,8 +937,6 @@ std::vector<vec3> Collider::clipPolyAgainstEdge(std::vector<vec3>& input, const
             if (glm::dot(refNorm, intersect - refCenter) < 0) output.push_back(intersect);
         }
     }
-
-    return output;
 }
 
 /*
@@ -563,203 +1041,281 @@ vec3 Collider::closestPointBtwnSegments(const vec3 p0, const vec3 p1, const vec3
     return (wc * 0.5f) + (q0 + v); // the closest point between the 2 segments in the world (q0 + (Tc * v) + W_c * 0.5f)
 }
 
-void Collider::genVerts() {
-    if (_type == Type::BOX) {
-        Mesh::FaceData data;//norms and UVs are empty
-        Mesh::FaceIndex indices;
-        data.verts = { {  _dims.x,  _dims.y,  _dims.z },
-                       { -_dims.x,  _dims.y,  _dims.z },
-                       {  _dims.x, -_dims.y,  _dims.z },
-                       { -_dims.x, -_dims.y,  _dims.z },
-                       {  _dims.x,  _dims.y, -_dims.z },
-                       { -_dims.x,  _dims.y, -_dims.z },
-                       {  _dims.x, -_dims.y, -_dims.z },
-                       { -_dims.x, -_dims.y, -_dims.z } };
+namespace {
+    std::mutex shapeMutex;
+    std::unordered_map<const Mesh*, weak<const ColliderShape>> meshShapes; // a mesh can't be freed while its shape is alive, so its address can't be reused for another
+    std::map<std::tuple<float, float, float>, weak<const ColliderShape>> boxShapes;
+
+    // looks up the shape in [cache], building and caching it if it isn't there or has been freed
+    template<class Cache, class Key, class Build>
+    shared<const ColliderShape> getCached(Cache& cache, const Key& key, Build build) {
+        std::lock_guard<std::mutex> lock(shapeMutex);
+        auto& entry = cache[key];
+        auto shape = entry.lock();
+        if (!shape) {
+            shape = build();
+            entry = shape;
+        }
+        return shape;
+    }
+}
+
+shared<const ColliderShape> ColliderShape::get(shared<Mesh> mesh) {
+    return getCached(meshShapes, mesh.get(), [&] { return make_shared<const ColliderShape>(mesh); });
+}
 
-        indices.verts = { 7, 3, 0, 7, 4, 0,
-                        6, 7, 4, 6, 5, 4,
-                        2, 6, 5, 2, 1, 5,
-                        3, 2, 1, 3, 0, 1,
-                        0, 1, 5, 0, 4, 5,
-                        7, 6, 2, 7, 3, 2 };
+shared<const ColliderShape> ColliderShape::box(const vec3 halfDims) {
+    return getCached(boxShapes, std::make_tuple(halfDims.x, halfDims.y, halfDims.z), [&] { return make_shared<const ColliderShape>(genBoxMesh(halfDims)); });
+}
 
-        mesh = make_shared<Mesh>(data, indices);
-    }
-    currVerts->clear();
-    currVerts->resize(mesh->data().verts.size());
+shared<const ColliderShape> ColliderShape::sphere() {
+    static const auto empty = make_shared<const ColliderShape>(nullptr);
+    return empty;
 }
 
-void Collider::genNormals() {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-        faceNormals = { vec3( 1,  0,  0),
-                        vec3(-1,  0,  0),
-                        vec3( 0,  0,  1),
-                        vec3( 0,  0, -1),
-                        vec3( 0,  1,  0),
-                        vec3( 0, -1,  0) };
-        break;
-    case Type::MESH:
-        // generate the face normals from the mesh's vertices
-        // when iterating over normals, to retrieve the vertices of the face corresponding to the normal at index i,
-        // the nth (0, 1, or 2) vertex in the face is meshVerts[faceVerts[i * 3 + n]]
-        // alternatively, if you aren't getting meshVerts, use the function getVert(faceVerts[i * 3 + n])
-        auto& faceVerts = mesh->indices().verts;
-        auto& meshVerts = mesh->data().verts;
-        for (size_t i = 0, numFaces = faceVerts.size(); i < numFaces; i += 3) {
-            const auto v = meshVerts[faceVerts[i]];
-
-            const auto e1 = meshVerts[faceVerts[i + 1]] - v;
-            const auto e2 = meshVerts[faceVerts[i + 2]] - v;
-
-            faceNormals.push_back(normalize(cross(e1, e2)));
-        }
-        break;
-    }
-    currNormals->clear();
-    currNormals->resize(faceNormals.size());
-}
-
-void Collider::genEdges() {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-    case Type::MESH:
-        auto& meshVerts = mesh->data().verts;
-        for (const auto& pair : gauss.adjacencies) {
-            for (const auto& adj : pair.second) {
-                setEdge(adj.edge, edges.size());
-                edges.push_back(meshVerts[adj.edge.second()] - meshVerts[adj.edge.first()]);
-            }
+// the order is important; edges depend on the gauss map, which depends on the normals
+ColliderShape::ColliderShape(shared<Mesh> m) : mesh(m) {
+    if (!mesh) return;
+    genVertAdjs();
+    genNormals();
+    genGaussMap();
+    genEdges();
+    checkConvex();
+}
+
+shared<Mesh> ColliderShape::genBoxMesh(const vec3 halfDims) {
+    Mesh::FaceData data;//norms and UVs are empty
+    Mesh::FaceIndex indices;
+    data.verts = { {  halfDims.x,  halfDims.y,  halfDims.z },
+                   { -halfDims.x,  halfDims.y,  halfDims.z },
+                   {  halfDims.x, -halfDims.y,  halfDims.z },
+                   { -halfDims.x, -halfDims.y,  halfDims.z },
+                   {  halfDims.x,  halfDims.y, -halfDims.z },
+                   { -halfDims.x,  halfDims.y, -halfDims.z },
+                   {  halfDims.x, -halfDims.y, -halfDims.z },
+                   { -halfDims.x, -halfDims.y, -halfDims.z } };
+
+    // two triangles per side, so they merge back into the box's 6 faces
+    indices.verts = { 0, 2, 6, 0, 6, 4,   // +x
+                      1, 5, 7, 1, 7, 3,   // -x
+                      0, 4, 5, 0, 5, 1,   // +y
+                      2, 3, 7, 2, 7, 6,   // -y
+                      0, 1, 3, 0, 3, 2,   // +z
+                      4, 6, 7, 4, 7, 5 }; // -z
+
+    return make_shared<Mesh>(data, indices);
+}
+
+void ColliderShape::genVertAdjs() {
+    const auto numVerts = mesh->data().verts.size();
+    auto& faceVerts = mesh->indices().verts;
+
+    // every face contributes its 3 edges in both directions
+    std::vector<std::pair<GLuint, GLuint>> links;
+    links.reserve(faceVerts.size() * 2);
+    for (size_t i = 0, numFaces = faceVerts.size(); i < numFaces; i += 3) {
+        for (auto j = 0; j < 3; ++j) {
+            const auto a = faceVerts[i + j], b = faceVerts[i + (j + 1) % 3];
+            links.push_back({ a, b });
+            links.push_back({ b, a });
         }
-        break;
     }
-    currEdges->clear();
-    currEdges->resize(edges.size());
+    std::sort(begin(links), end(links));
+    links.erase(std::unique(begin(links), end(links)), end(links));
+
+    vertAdjOffsets.assign(numVerts + 1, 0);
+    vertAdjs.clear();
+    vertAdjs.reserve(links.size());
+    for (const auto& link : links) {
+        ++vertAdjOffsets[link.first + 1];
+        vertAdjs.push_back(link.second);
+    }
+    for (size_t i = 0; i < numVerts; ++i)
+        vertAdjOffsets[i + 1] += vertAdjOffsets[i];
 }
 
-void Collider::genGaussMap() {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-        // need to set up proper handling for box colliders for vertices
-        //gauss.addAdj(faceNormals[0], Adj{  });
-        //gauss.adjacencies[faceNormals[1]] = { Adj{ 2, {,} } };
-        break;
-    case Type::MESH:
-        // set up the edge associations
-        auto& faceVerts = mesh->indices().verts;
-        //adjacencies = std::vector<std::vector<Adj>>(numFaces / 3, std::vector<Adj>());
-        for (size_t i = 0, numFaces = faceVerts.size(); i < numFaces; i += 3) {
-            for (auto j = i + 3; j < numFaces; j += 3) {
-                // if (fuzzyParallelUnit(faceNormals[i / 3], faceNormals[j / 3])) continue;
-
-                auto src = -1;
-                auto added = false;
-                for (size_t p1 = 0; !added && p1 < 3; ++p1) {
-                    for (size_t p2 = 0; p2 < 3; ++p2) {
-                        // continue if there's no match
-                        if (faceVerts[i + p1] != faceVerts[j + p2]) continue;
-                        
-                        // if a match hasn't been found yet, just record it
-                        if (src < 0) src = faceVerts[i + p1];
-                        // otherwise, record it, set the normal, push it back, and end the loop
-                        else {
-                            const GLuint usrc = src;
-                            const auto dst = faceVerts[i + p1];
-                            Adj adj{ { i/3, j/3 }, { usrc, dst } };
-                            gauss.addAdj(faceNormals[adj.faces.first], adj);
-                            added = true;
-                        }
-                        // none of the other vertices can be equal to this one now, so move to the next one
-                        break;
-                    }
-                } // end edge loop
+/*
+----------------------------------------------------------------------
+- Faces are built by merging every group of adjacent, coplanar triangles, so flat regions made of several triangles are tested once
+  - e.g. a box's 12 triangles become 6 faces, and the arcs between coplanar triangles (which can never be separating axes) are never made
+  - Each face is stored as the loop of verts around its boundary, found from the edges of its triangles that no other triangle in it shares
+- Triangle normals are oriented away from the center, as colliders are centered on the origin, so the mesh's winding doesn't matter
+- Degenerate triangles don't belong to any face
+----------------------------------------------------------------------
+*/
+void ColliderShape::genNormals() {
+    auto& tris = mesh->indices().verts;
+    auto& meshVerts = mesh->data().verts;
+    const auto numTris = tris.size() / 3;
+
+    std::vector<std::array<GLuint, 3>> triVerts(numTris);
+    std::vector<vec3> triNormals(numTris);
+    std::vector<float> area(numTris); // face normals are weighted by area, so slivers don't skew them
+    std::vector<char> degenerate(numTris, 0);
+    for (size_t t = 0; t < numTris; ++t) {
+        auto verts = std::array<GLuint, 3>{ tris[t * 3], tris[t * 3 + 1], tris[t * 3 + 2] };
+        const auto v0 = meshVerts[verts[0]], v1 = meshVerts[verts[1]], v2 = meshVerts[verts[2]];
+        auto normal = glm::cross(v1 - v0, v2 - v0);
+        if (glm::dot(normal, v0 + v1 + v2) < 0) {
+            std::swap(verts[1], verts[2]);
+            normal = -normal;
+        }
+        triVerts[t] = verts;
+        triNormals[t] = normal;
+        area[t] = glm::length(normal);
+        degenerate[t] = area[t] < FLT_EPSILON;
+    }
 
+    // triangles sharing each edge
+    std::unordered_map<Edge, std::vector<size_t>> edgeTris;
+    for (size_t t = 0; t < numTris; ++t) {
+        if (degenerate[t]) continue;
+        triNormals[t] /= area[t];
+        for (auto k = 0; k < 3; ++k)
+            edgeTris[Edge(triVerts[t][k], triVerts[t][(k + 1) % 3])].push_back(t);
+    }
+
+    // grows each face out from a seed triangle, comparing against the seed's normal so a gently curved surface can't merge into one face a step at a time
+    std::vector<char> assigned(degenerate);
+    std::vector<std::vector<std::pair<GLuint, GLuint>>> faceEdges;
+    std::vector<size_t> frontier;
+    for (size_t seed = 0; seed < numTris; ++seed) {
+        if (assigned[seed]) continue;
+
+        const auto seedNormal = triNormals[seed];
+        faceEdges.emplace_back();
+        faceNormals.push_back(vec3());
+        auto& edgeList = faceEdges.back();
+
+        assigned[seed] = 1;
+        frontier.assign(1, seed);
+        while (frontier.size()) {
+            const auto t = frontier.back();
+            frontier.pop_back();
+
+            faceNormals.back() += triNormals[t] * area[t];
+            for (auto k = 0; k < 3; ++k) {
+                const auto from = triVerts[t][k], to = triVerts[t][(k + 1) % 3];
+                edgeList.push_back({ from, to });
+                for (const auto other : edgeTris[Edge(from, to)]) {
+                    if (assigned[other] || glm::dot(seedNormal, triNormals[other]) <= 1 - COPLANAR_TOLERANCE) continue;
+                    assigned[other] = 1;
+                    frontier.push_back(other);
+                }
             }
-        } // end face loop
-        break;
+        }
     }
-}
 
-void Collider::updateVerts(std::vector<vec3>& currVerts) {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-    case Type::MESH:
-        const auto world = _transform->getMats()->world;
-        auto& verts = mesh->data().verts;
-        for (size_t i = 0, numVerts = verts.size(); i < numVerts; ++i) {
-            currVerts[i] = (vec3)(world * vec4(verts[i], 1));
+    // the boundary of a face is every edge whose reverse isn't in the face, and they chain into the face's loop
+    faceLoopOffsets.assign(1, 0);
+    faceLoops.clear();
+    std::unordered_map<GLuint, GLuint> next;
+    for (size_t face = 0, numFaces = faceEdges.size(); face < numFaces; ++face) {
+        faceNormals[face] = glm::normalize(faceNormals[face]);
+
+        auto& edgeList = faceEdges[face];
+        std::sort(begin(edgeList), end(edgeList));
+        next.clear();
+        for (const auto& e : edgeList) {
+            if (!std::binary_search(begin(edgeList), end(edgeList), std::make_pair(e.second, e.first)))
+                next[e.first] = e.second;
         }
-        break;
+
+        const auto start = begin(next)->first;
+        auto v = start;
+        do {
+            faceLoops.push_back(v);
+            v = next[v];
+        } while (v != start && faceLoops.size() - faceLoopOffsets.back() < next.size());
+        faceLoopOffsets.push_back((GLuint)faceLoops.size());
     }
 }
 
-void Collider::updateNormals(std::vector<vec3>& currNormals) {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-    case Type::MESH:
-        const auto rot = _transform->getMats()->rotate;
-        //auto& faceVerts = mesh->faces().verts;
-        for (size_t i = 0, numNormals = faceNormals.size(); i < numNormals; ++i) {
-            currNormals[i] = (vec3)(rot * vec4(faceNormals[i], 0));
+// every vert is checked against every face, but that only happens once per mesh, and concave meshes usually fail on their first few faces
+void ColliderShape::checkConvex() {
+    auto& verts = mesh->data().verts;
+    const auto numVerts = verts.size();
+    if (!numVerts) return;
+
+    auto maxDist = 0.f;
+    for (const auto& v : verts) maxDist = maxf(maxDist, glm::length(v));
+    const auto tolerance = CONVEX_TOLERANCE * maxDist;
+
+    for (size_t face = 0, numFaces = faceNormals.size(); face < numFaces; ++face) {
+        const auto normal = faceNormals[face];
+        const auto dist = glm::dot(normal, verts[faceLoops[faceLoopOffsets[face]]]);
+        for (const auto& v : verts) {
+            if (glm::dot(normal, v) - dist > tolerance) return;
+        }
+    }
 
-            //const auto  a = getVert(faceVerts[i * 3])
-            //          , b = getVert(faceVerts[i * 3 + 1])
-            //          , c = getVert(faceVerts[i * 3 + 2]);
-            //auto center = a + b + c;
-            //center /= 3;
-            //DrawDebug::get().drawDebugVector(center, center + currNormals[i]);
+    // unused and split verts leave the graph in pieces, which a climb can't cross
+    std::vector<char> reached(numVerts, 0);
+    std::vector<GLuint> frontier(1, 0);
+    reached[0] = 1;
+    size_t numReached = 1;
+    while (frontier.size()) {
+        const auto vert = frontier.back();
+        frontier.pop_back();
+        for (auto i = vertAdjOffsets[vert], end = vertAdjOffsets[vert + 1]; i < end; ++i) {
+            const auto next = vertAdjs[i];
+            if (reached[next]) continue;
+            reached[next] = 1;
+            ++numReached;
+            frontier.push_back(next);
         }
-        break;
     }
+    convex = numReached == numVerts;
 }
 
-void Collider::updateEdges(std::vector<vec3>& currEdges) {
-    switch (_type) {
-    case Type::SPHERE:
-        break;
-    case Type::BOX:
-    case Type::MESH:
-        const auto world = _transform->getMats()->world;
-        for (size_t i = 0, numEdges = edges.size(); i < numEdges; ++i) {
-            // we only care about rotating and scaling the edge, translation is discarded
-            currEdges[i] = (vec3)(world * vec4(edges[i], 0));
-        }
-        
-        /*for (auto& pair : gauss.adjacencies) {
-            for (auto adj : pair.second) {
-                auto s = getVert(adj.edge[0]);
-                auto edge = getEdge(adj.edge);
-                DrawDebug::get().drawDebugVector(s, s + edge);
-            }
-        }*/
-        break;
+void ColliderShape::genEdges() {
+    auto& meshVerts = mesh->data().verts;
+    for (const auto& adj : gauss.adjs) {
+        edgeMap[adj.edge] = (GLuint)edges.size();
+        edges.push_back(meshVerts[adj.edge.second()] - meshVerts[adj.edge.first()]);
     }
 }
 
-const std::vector<vec3>& Collider::getCurrVerts() { return currVerts(); }
-const std::vector<vec3>& Collider::getCurrNormals() { return currNormals(); }
-const std::vector<vec3>& Collider::getCurrEdges() { return currEdges(); }
+// every edge shared by two faces becomes an arc between their normals
+void ColliderShape::genGaussMap() {
+    std::unordered_map<Edge, GLuint> edgeFaces;
+    for (GLuint face = 0, numFaces = (GLuint)faceNormals.size(); face < numFaces; ++face) {
+        const auto first = faceLoopOffsets[face], last = faceLoopOffsets[face + 1];
+        for (auto i = first; i < last; ++i) {
+            const Edge edge(faceLoops[i], faceLoops[i + 1 < last ? i + 1 : first]);
+            const auto it = edgeFaces.insert({ edge, face });
+            if (it.second) continue;
+
+            const Adj adj{ { it.first->second, face }, edge };
+            gauss.addArc(faceNormals[adj.faces.first], faceNormals[adj.faces.second], adj);
+        }
+    }
+    gauss.pad();
+}
 
-GLuint Collider::getFaceVert(GLuint index) const { return mesh->indices().verts[index]; }
-vec3 Collider::getVert(GLuint index) { return currVerts()[index]; }
-vec3 Collider::getNormal(GLuint index) { return currNormals()[index]; }
-vec3 Collider::getEdge(Edge e) { return currEdges()[edgeMap.at(e)]; }
-void Collider::setEdge(Edge e, const GLuint index) { edgeMap[e] = index; }
+vec3 Collider::toWorld(const vec3 localPoint) const { return _framePos + _frameRot * (_frameScale * localPoint); }
+vec3 Collider::getLocalEdge(Edge e) const { return _frameScale * shape->edges[shape->edgeMap.at(e)]; }
 
-const GaussMap& Collider::getGaussMap() const { return gauss; }
+vec3 Collider::getVert(GLuint index) const { return toWorld(shape->mesh->data().verts[index]); }
+vec3 Collider::getNormal(GLuint index) const { return _frameRot * shape->faceNormals[index]; }
+vec3 Collider::getEdge(Edge e) const { return _frameRot * getLocalEdge(e); }
 
-const std::vector<Adj>& GaussMap::getAdjs(vec3 v) const { return adjacencies.at(v); }
-void GaussMap::addAdj(vec3 v, Adj a) { adjacencies[v].push_back(a); }
+const GaussMap& Collider::getGaussMap() const { return shape->gauss; }
+
+void GaussMap::addArc(const vec3 normA, const vec3 normB, const Adj adj) {
+    adjs.push_back(adj);
+    a.push_back(normA);
+    b.push_back(normB);
+    bxa.push_back(glm::cross(normB, normA));
+}
+
+void GaussMap::pad() {
+    while (a.size() % WIDTH) {
+        a.push_back(vec3());
+        b.push_back(vec3());
+        bxa.push_back(vec3());
+    }
+}
 
 bool AABB::intersects(const AABB& other) const {
     auto back  = center - halfDims, otherBack  = other.center - other.halfDims;
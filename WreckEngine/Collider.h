@@ -1,10 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
-#include "frame_cache.h"
+#include "small_vector.h"
 
 #include "Transform.h"
 #include "Mesh.h"
@@ -12,6 +13,7 @@
 #include "DrawDebug.h"
 
 class Collider;
+class ColliderShape;
 
 struct AABB {
     vec3 center, halfDims;
@@ -37,20 +39,54 @@ namespace std { template<> struct hash<Edge> { auto operator()(const Edge& t) co
 
 struct Adj { std::pair<GLuint, GLuint> faces; Edge edge; };
 
+// vec3s stored as separate component arrays, so they can be loaded 4 at a time
+// the arcs of the Gauss map, baked into flat arrays; arc i runs between normals a[i] and b[i], and represents the edge in adjs[i]
 struct GaussMap {
-    // keys are untransformed normals, adjacencies use indices because of rotations
-    std::unordered_map<vec3, std::vector<Adj>> adjacencies;
-    void addAdj(vec3 v, Adj a);
-    const std::vector<Adj>& getAdjs(vec3 v) const;
+    static constexpr size_t WIDTH = 4; // the arc data is padded to a multiple of this with degenerate arcs, which can't intersect anything
+
+    std::vector<Adj> adjs; // not padded, so this gives the actual number of arcs
+    vec3_soa a, b, bxa;    // untransformed normals, and the normal of the plane through the arc (b x a)
+
+    size_t size() const { return adjs.size(); }
+    void addArc(const vec3 normA, const vec3 normB, const Adj adj);
+    void pad();
 };
 
 struct SupportPoint { vec3 point; float proj; };
 
+// identifies the features a contact was generated from, so contacts can be matched up between ticks
+struct ContactFeature {
+    enum class Type : uint8_t { NONE, FACE, EDGE };
+    Type type = Type::NONE;
+    GLuint face = 0; // the reference face on the originator, for face contacts
+    Edge edges[2];   // the edges on the originator and the other collider, for edge contacts
+
+    bool operator==(const ContactFeature& other) const noexcept {
+        if (type != other.type) return false;
+        return type == Type::FACE ? face == other.face : (type == Type::NONE || (edges[0] == other.edges[0] && edges[1] == other.edges[1]));
+    }
+    bool operator!=(const ContactFeature& other) const noexcept { return !(*this == other); }
+};
+
 struct Manifold {
+    // enough for any pair of boxes; only faces with more sides than that can push the points onto the heap
+    static constexpr size_t INLINE_POINTS = 8;
+
     Collider* originator = nullptr, *other = nullptr;
-    std::vector<vec3> colPoints;
+    small_vector<vec3, INLINE_POINTS> colPoints;
     float pen = -FLT_MAX;
     vec3 axis;
+    ContactFeature feature;
+    float impulse = 0; // the impulse applied along the axis; starts as the impulse carried over from the last tick, if any
+    float bounce = 0;  // the speed the solver separates the bodies at along the axis
+};
+
+// the axis that last separated a pair of colliders, which is very likely to still separate them on the next test
+struct SeparatingAxis {
+    enum class Type : uint8_t { NONE, FACE, OTHER_FACE, EDGE };
+    Type type = Type::NONE;
+    GLuint face = 0; // a face on the tested collider (FACE) or the collider it's tested against (OTHER_FACE)
+    Edge edges[2];   // the edges on the tested collider and the other collider (EDGE)
 };
 
 struct FaceManifold : Manifold { GLuint norm; };
@@ -60,65 +96,131 @@ class Collider
 {
 public:
     static constexpr float PEN_TOLERANCE = 0.03f * -1.f;
+    static constexpr size_t HILL_CLIMB_MIN_VERTS = 32; // support queries on convex colliders with fewer verts (and all concave ones) use a linear scan instead
     enum class Type { SPHERE, BOX, MESH };
+    enum class Method { SAT, GJK }; // the algorithms available for finding contacts
+
+    // sets the method used for each collider type; a pair only uses GJK if it's set for both types, so boxes keep SAT unless switched over too
+    // these are shared by every collider, so they should be set up before the physics thread starts
+    // pairs of spheres and boxes always use their exact routines instead, and spheres can only use GJK against meshes
+    static void setTypeMethod(const Type type, const Method method);
+    static Method getTypeMethod(const Type type);
+    Method getPairMethod(const Collider* other) const;
 
     Collider(Transform* t, const vec3 d, const bool fudge = true);
+    Collider(Transform* t, const float r);
     Collider(shared<Mesh> m, Transform* t);
 
     const AABB& aabb() { return transformed_aabb; }
     void updateDims();
 
-    Manifold intersects(Collider* other);
-
-    std::vector<GLuint> getIncidentFaces(const vec3 refNormal);
-    void clipPolygons(FaceManifold& reference, const std::vector<GLuint>& incidents);
-    std::vector<vec3> clipPolyAgainstEdge(std::vector<vec3>& input, const vec3 sideNormal, const vec3 sideVert, const vec3 refNorm, const vec3 refCenter) const;
+    // when [lastAxis] is given, it's tested first and updated with whichever axis separates the colliders, if any (SAT only)
+    Manifold intersects(Collider* other, SeparatingAxis* lastAxis = nullptr);
+    Manifold intersects(Collider* other, Method method, SeparatingAxis* lastAxis = nullptr);
+    Manifold intersectsSAT(Collider* other, SeparatingAxis* lastAxis = nullptr);
+    Manifold intersectsGJK(Collider* other);
+    Manifold intersectsSpheres(Collider* other);
+    Manifold intersectsBoxSphere(Collider* sphere);
+    Manifold intersectsBoxes(Collider* other);
+    bool separates(Collider* other, const SeparatingAxis& axis);
+    float getSeparation(Collider* other, const vec3 axis);
+
+    // clipping works on these, which are sized so that boxes and most meshes never need the heap
+    using FaceList = small_vector<GLuint, 8>;
+    using Polygon = small_vector<vec3, 32>;
+
+    FaceList getIncidentFaces(const vec3 refNormal);
+    void clipPolygons(FaceManifold& reference, const FaceList& incidents);
+    // clips [input] against a single side plane, replacing the contents of [output] with the result
+    void clipPolyAgainstEdge(const Polygon& input, Polygon& output, const vec3 sideNormal, const vec3 sideVert, const vec3 refNorm, const vec3 refCenter) const;
     vec3 closestPointBtwnSegments(const vec3 p0, const vec3 p1, const vec3 q0, const vec3 q1) const;
 
     void update();
+    // moves the collider to [pos] without touching its transform, so it can be tested at other points along its path; update() moves it back
+    void moveFrame(const vec3 pos);
 
-    void genVerts();
-    void genNormals();
-    void genEdges();
-    void genGaussMap();
-
-    // these functions can update the frame-cache, and so aren't const
-    const std::vector<vec3>& getCurrVerts();
-    const std::vector<vec3>& getCurrNormals();
-    const std::vector<vec3>& getCurrEdges();
-
-    inline GLuint getFaceVert(const GLuint index) const;
-    inline vec3 getVert(const GLuint index);
-    inline vec3 getNormal(const GLuint index);
-    inline vec3 getEdge(Edge e);
+    // these transform a single vert, normal, or edge into world space as of the last update
+    inline vec3 getVert(const GLuint index) const;
+    inline vec3 getNormal(const GLuint index) const;
+    inline vec3 getEdge(Edge e) const;
+    // appends the plane of every face in world space as of the last update, as (outward normal, distance from the origin)
+    void getFacePlanes(std::vector<vec4>& planes) const;
 
     const GaussMap& getGaussMap() const;
 
     SupportPoint getSupportPoint(const vec3 dir);
+    SupportPoint getLocalSupportPoint(const vec3 dir);
+    SupportPoint getSupportPointLinear(const vec3 dir);
+    SupportPoint getSupportPointHillClimb(const vec3 dir);
     FaceManifold getAxisMinPen(Collider* other);
     EdgeManifold overlayGaussMaps(Collider* other);
 
 private:
     Collider(const Type type, shared<Mesh> m, Transform* t, const vec3 d, const bool fudge = true);
 
-    void updateVerts(std::vector<vec3>& currNormals);
-    void updateNormals(std::vector<vec3>& currNormals);
-    void updateEdges(std::vector<vec3>& currEdges);
+    void setDims(const vec3 value); // boxes get the shape of their new dims too
+    mat3 getLocalDirMatrix() const;
+    inline vec3 toWorld(const vec3 localPoint) const;
+    inline vec3 getLocalEdge(Edge e) const; // scaled, but not rotated
 
     ACCS_G    (private, Transform*, transform);
+    // the transform as of the last update; collision detection only uses these, so the transform can't change out from under it
     ACCS_G    (private, vec3,  framePos);
-    ACCS_GS_C (private, vec3,  dims, { return _dims; }, { _dims = base_aabb.halfDims = value; updateDims(); });
+    ACCS_G    (private, vec3,  frameScale) { 1 };
+    ACCS_G    (private, mat3,  frameRot)   { 1 };
+    ACCS_GS_C (private, vec3,  dims, { return _dims; }, { setDims(value); });
     ACCS_G    (private, float, radius) = 0;
     ACCS_G    (private, Type, type);
 
+    static Method typeMethods[3];
+
     bool fudgeAABB = true; // if this is true, the transformed AABB will be scaled by some factor
     AABB base_aabb, transformed_aabb;
 
+    shared<const ColliderShape> shape; // shared with every other collider of the same mesh
+    // where the last hill climb ended; it's only a starting point, so threads racing on it just cost a few extra steps
+    copy_wrap<std::atomic<GLuint>> supportHint;
+};
+
+/*
+----------------------------------------------------------------------
+- The parts of a collider that don't depend on its transform: its mesh's faces, edges, Gauss map, and vertex adjacency
+- These are built once per mesh and shared by every collider using it, so spawning many copies of a shape only builds it once
+  - Boxes of the same dims share a shape too, and spheres all share an empty one
+  - The cache only holds weak references, so a shape goes away with the last collider using it
+  - Meshes are assumed not to change once colliders use them, as their shapes wouldn't be rebuilt
+- Shapes are never modified after they're built, so any thread can read them without locking
+- Each shape is checked for convexity when it's built, as only convex shapes can find their support points by hill climbing
+----------------------------------------------------------------------
+*/
+class ColliderShape {
+public:
+    static constexpr float COPLANAR_TOLERANCE = 0.0005f; // triangles whose normals' dot product with the first triangle of a face is within this of 1 are merged into it
+    static constexpr float CONVEX_TOLERANCE = 0.001f; // how far verts can stick out past a face and still count as convex, relative to the furthest vert from the center
+
+    static shared<const ColliderShape> get(shared<Mesh> mesh);
+    static shared<const ColliderShape> box(const vec3 halfDims);
+    static shared<const ColliderShape> sphere();
+
+    // builds a shape that isn't cached; use the functions above instead
+    explicit ColliderShape(shared<Mesh> m);
+
+    shared<Mesh> mesh; // null for spheres
     std::vector<vec3> faceNormals, edges; // these are vec3s to avoid constant typecasting, and b/c cross product doesn't work for 4d vectors
-    frame_cache<std::vector<vec3>, Collider> currVerts{ this, &Collider::updateVerts }, currNormals{ this, &Collider::updateNormals }, currEdges{ this, &Collider::updateEdges };
+    // the faces' vertex loops, flattened; the verts of face i, counter-clockwise from outside, are faceLoops[faceLoopOffsets[i]] up to faceLoops[faceLoopOffsets[i + 1]]
+    std::vector<GLuint> faceLoopOffsets, faceLoops;
     std::unordered_map<Edge, GLuint> edgeMap; // maps the edge pairs to the indices in edges
+    // the vertex adjacency graph, flattened; the neighbors of vert i are vertAdjs[vertAdjOffsets[i]] up to vertAdjs[vertAdjOffsets[i + 1]]
+    std::vector<GLuint> vertAdjOffsets, vertAdjs;
     GaussMap gauss;
-    shared<Mesh> mesh;
+    // whether no vert lies outside any face, and the vertex adjacency graph is connected, so a hill climb can't get stuck short of the support point
+    bool convex = false;
 
-    void setEdge(Edge e, const GLuint index);
+private:
+    static shared<Mesh> genBoxMesh(const vec3 halfDims);
+    void genVertAdjs();
+    void genNormals(); // merges coplanar triangles into faces, generating their normals and vertex loops
+    void genGaussMap();
+    void genEdges();
+    void checkConvex();
 };
\ No newline at end of file
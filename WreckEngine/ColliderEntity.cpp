@@ -3,82 +3,114 @@
 #include "CollisionManager.h"
 
 ColliderEntity::ColliderEntity(shared<DrawMesh> s)
-    : Entity(s), _collider(make_unique<Collider>(shared<Mesh>{s->mesh()}, &transform))
+    : Entity(s), _collider(make_unique<Collider>(shared<Mesh>{s->mesh()}, &transform)), body(this)
 {
 	CollisionManager::getInstance().addEntity(this);
 }
 
 ColliderEntity::ColliderEntity(vec3 p, vec3 dims, vec3 sc, vec3 rA, float r, shared<DrawMesh> s)
-    : Entity(p, sc, rA, r, s), _collider(make_unique<Collider>(shared<Mesh>{s->mesh()}, &transform))
+    : Entity(p, sc, rA, r, s), _collider(make_unique<Collider>(shared<Mesh>{s->mesh()}, &transform)), body(this)
 {
 	CollisionManager::getInstance().addEntity(this);
 }
 
-void ColliderEntity::physicsUpdate(double delta) {
-	auto dt = (float)delta;
-	calcForces(delta);
-	body.update(delta);
-	transform.position += body.vel() * dt;
-	transform.rotate(body.angVel() * dt);
-	_collider->update();
-	assert(!NaN_CHECK(transform.position().x));
+ColliderEntity::ColliderEntity(shared<Mesh> m)
+    : Entity(nullptr), _collider(make_unique<Collider>(m, &transform)), body(this)
+{
+	CollisionManager::getInstance().addEntity(this);
+}
+
+ColliderEntity::ColliderEntity(vec3 halfDims)
+    : Entity(nullptr), _collider(make_unique<Collider>(&transform, halfDims)), body(this)
+{
+	CollisionManager::getInstance().addEntity(this);
 }
 
-void ColliderEntity::calcForces(double dt) {
-	body.applyGravity();
-	
-	//collision resolution stuff here
-	body.netForce    += body.quadDrag(-1.f, body.vel(), body.heading());// quadratic drag, no mass involved, it's all velocity dependent
-	body.netAngAccel += body.quadDrag(-2.f, body.angVel(), body.angHeading());// for angular acceleration too
+ColliderEntity::ColliderEntity(float radius)
+    : Entity(nullptr), _collider(make_unique<Collider>(&transform, radius)), body(this)
+{
+	CollisionManager::getInstance().addEntity(this);
+}
+
+ColliderEntity::~ColliderEntity() {
+	CollisionManager::getInstance().removeEntity(this);
 }
 
 //override this (and preferably call it) to change on-collision behavior
-//decrement the numCollisions counter if this collision is considered "resolved" without actually resolving the collision
-void ColliderEntity::handleCollision(ColliderEntity* other, Manifold& m, double dt, size_t& numCollisions) {
+//called once per tick for every contact this entity originates, before the contact solver runs; return false to leave the contact out of the solve
+//it's called on the physics thread, one contact at a time, so overrides can touch the rest of the game as any physics code can
+//entities made here only join the world at the start of the next tick, and entities can't be destroyed here, as the tick is still using them
+//m.impulse starts as the impulse carried over from the last tick's contact, and holds the total impulse applied once solved
+bool ColliderEntity::handleCollision(ColliderEntity* other, Manifold& m, double dt) {
 	auto& oRB = other->rigidBody;
 
-	//if the two bodies are traveling in the same direction along the axis
-	auto speedAlongAxis = glm::dot(oRB.vel() - body.vel(), m.axis);
-	if (speedAlongAxis > 0) return;
-
 	//coefficient of restitution. we take the min of the two coefficients
 	//when e = 0, it is a perfect inelastic/plastic collision, and the objects stick together
 	//when 0 < e < 1, it is a regular inelastic collision, with some energy dissipated
 	//when e = 1, it is an elastic collision, where all energy is put into the response
 	float e = minf(body.restitution(), oRB.restitution());
 
-	auto j = speedAlongAxis;// magnitude of impulse
-	j *= -(1 + e);
-	j /= body.invMass() + oRB.invMass() /* + std::pow(rad * t, 2) / inertia + std::pow(orad * t, 2) / oinertia */;
+	//the bounce comes from the speed before any impulses are applied; the solver only pushes the bodies apart this fast
+	auto speedAlongAxis = glm::dot(oRB.vel() - body.vel(), m.axis);
+	m.bounce = speedAlongAxis < -MIN_BOUNCE_VEL ? -e * speedAlongAxis : 0;
 
-	auto impulse = j * m.axis;
-	body.vel  -= body.invMass() * impulse;
+	//warm starting: apply the carried over impulse first, so the bodies start close to their resting velocities
+	if (m.impulse > 0)
+		applyImpulse(other, m.impulse * m.axis);
+
+	return true;
+}
+
+//a single sequential impulse iteration
+//the impulse needed to reach the target speed along the axis is added to the total, which is clamped so contacts can only ever push
+void ColliderEntity::solveContact(ColliderEntity* other, Manifold& m) {
+	auto& oRB = other->rigidBody;
+	const auto invMassSum = body.invMass() + oRB.invMass() /* + std::pow(rad * t, 2) / inertia + std::pow(orad * t, 2) / oinertia */;
+	if (!invMassSum) return;
+
+	auto speedAlongAxis = glm::dot(oRB.vel() - body.vel(), m.axis);
+	auto total = maxf(m.impulse + (m.bounce - speedAlongAxis) / invMassSum, 0.f);
+	auto j = total - m.impulse;
+	m.impulse = total;
+
+	applyImpulse(other, j * m.axis);
 	// _angVel -= inv_inertia * cross(radiusVec, impulse);
-	oRB.vel   += oRB.invMass()  * impulse;
+}
+
+//applies the parts of the response that depend on the solved impulse: torque and position correction
+void ColliderEntity::applyContact(ColliderEntity* other, Manifold& m, double dt) {
+	auto& oRB = other->rigidBody;
 
 	//F is the force applied by the collision; we use the definition F = dp / dt, where p = momentum and dp = impulse
-	j /= (float)dt;
-	auto F = j * m.axis;
-	//body.netForce +=  F;
-	//oRB.netForce  -=  F;
+	auto F = m.impulse / (float)dt * m.axis;
 	//DrawDebug::get().drawDebugVector(_transform.position, _transform.position() + F, vec3(0,1,1));
 	//DrawDebug::get().drawDebugVector(other->transform.position, other->transform.position() - F, vec3(1,1,0));
 
 	//they have the same collision points by definition, but vecs to those points change, meaning torque and covariance also change
-	body.netAngAccel += calcAngularAccel(m, F);
-	oRB.netAngAccel  += other->calcAngularAccel(m, -F);
+	if (body.invMass()) body.applyAngAccel(calcAngularAccel(m, F));
+	if (oRB.invMass())  oRB.applyAngAccel(other->calcAngularAccel(m, -F));
+
+	const auto invMassSum = body.invMass() + oRB.invMass();
+	if (!invMassSum) return;
 
 	//correct positions
-	const auto percent = 0.4f, slop = 0.025f;
-	auto correction = maxf(-m.pen + slop, 0.f) * percent / (body.invMass() + oRB.invMass()) * m.axis;
+	//the slop is deeper than Collider::PEN_TOLERANCE, otherwise resting contacts get pushed out of range and flicker in and out every tick
+	const auto percent = 0.4f, slop = 0.05f;
+	auto correction = maxf(-m.pen - slop, 0.f) * percent / invMassSum * m.axis;
 
-	transform.position        -= body.invMass() * correction;
-	other->transform.position += oRB.invMass()  * correction;
+	if (body.invMass()) transform.position        -= body.invMass() * correction;
+	if (oRB.invMass())  other->transform.position += oRB.invMass()  * correction;
 
 	assert(!NaN_CHECK(transform.position().x));
 	assert(!NaN_CHECK(other->transform.position().x));
+}
 
-	--numCollisions;
+//pushes this entity and the other apart along the impulse
+//infinite mass bodies are never written to, so islands sharing static bodies can be solved in parallel
+void ColliderEntity::applyImpulse(ColliderEntity* other, vec3 impulse) {
+	auto& oRB = other->rigidBody;
+	if (body.invMass()) body.vel(body.vel() - body.invMass() * impulse);
+	if (oRB.invMass())  oRB.vel(oRB.vel()   + oRB.invMass()  * impulse);
 }
 
 //Given a collision force F, calculates the change in angular acceleration it causes
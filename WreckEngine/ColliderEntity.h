@@ -16,16 +16,25 @@ class ColliderEntity : public Entity
 public:
 	ColliderEntity(shared<DrawMesh> s);
 	ColliderEntity(vec3 p, vec3 dims, vec3 sc, vec3 rA, float r, shared<DrawMesh> s);
+	// an entity that collides with [m] but isn't drawn, e.g. for simulating without a window
+	explicit ColliderEntity(shared<Mesh> m);
+	// the same, colliding as a box with [halfDims], or a sphere of [radius]
+	explicit ColliderEntity(vec3 halfDims);
+	explicit ColliderEntity(float radius);
+	// leaves the collision manager at the start of its next update, so nothing keeps testing against it once it's gone
+	~ColliderEntity();
 
 	RigidBody& rigidBody = body;
 
-	virtual void physicsUpdate(double dt);
-	virtual void calcForces(double dt);
-	virtual void handleCollision(ColliderEntity* other, Manifold& m, double dt, size_t& numCollisions);
+	virtual bool handleCollision(ColliderEntity* other, Manifold& m, double dt);
+	void solveContact(ColliderEntity* other, Manifold& m);
+	void applyContact(ColliderEntity* other, Manifold& m, double dt);
 	vec3 calcAngularAccel(Manifold& m, vec3 F);
 protected:
+	void applyImpulse(ColliderEntity* other, vec3 impulse);
+
 	ACCS_G_T_C (protected, unique<Collider>, Collider*, collider, { return _collider.get(); });
-	RigidBody body;
+	RigidBody body; // declared last, so it's destroyed first (see ~RigidBody)
 };
 
 PARENT_TYPE(ColliderEntity, Entity);
\ No newline at end of file
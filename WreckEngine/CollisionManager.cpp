@@ -1,71 +1,509 @@
 #include "CollisionManager.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include "DebugBenchmark.h"
+#include "GJK.h"
 
-CollisionManager::CollisionManager() { 
-	float d = 100.f; 
-	//octTree = std::make_unique(new OctTree(vec3(), vec3(d, d, d))); 
+namespace {
+    // bodies with infinite mass aren't moved by contacts, so they never join islands
+    inline bool isDynamic(ColliderEntity* e) { return e->rigidBody.invMass() != 0; }
+    // whether a body can start new contacts; infinite mass bodies can't sleep, but count as long as they're moving
+    inline bool isAwake(ColliderEntity* e) { return isDynamic(e) ? !e->rigidBody.asleep() : !e->rigidBody.resting(); }
+    // whether a body moved far enough last update that it could have passed through something; only dynamic bodies can be moved back
+    inline bool isFast(ColliderEntity* e) {
+        const auto motion = e->rigidBody.motion();
+        const auto radius = e->collider()->radius();
+        return isDynamic(e) && glm::dot(motion, motion) > radius * radius;
+    }
 }
 
+CollisionManager::CollisionManager() : broad(BroadPhase::create(broadType)) {}
+
 void CollisionManager::addEntity(ColliderEntity* o) {
-	//octTree->add(o);
-	for (auto c : objects) {
-		collisionPairs.push_back(std::pair<ColliderEntity*, ColliderEntity*>(o, c));
-	}
-	objects.push_back(o);
+    std::lock_guard<std::mutex> lock(pendingMut);
+    pendingAdds.push_back(o);
 }
 
-void CollisionManager::update(float dt) {
-	//octTree->update();
+void CollisionManager::removeEntity(ColliderEntity* o) {
+    query.remove(o);
+
+    std::lock_guard<std::mutex> lock(pendingMut);
+    // an entity that never made it into the world just drops out of the queue, as its address could be reused before the next update
+    const auto it = std::find(begin(pendingAdds), end(pendingAdds), o);
+    if (it != end(pendingAdds))
+        pendingAdds.erase(it);
+    else
+        pendingRemoves.push_back(o);
+}
+
+// removals go first, so an entity made at the address of one destroyed since the last update is added after the old one leaves
+void CollisionManager::applyPending() {
+    std::lock_guard<std::mutex> lock(pendingMut);
+    for (auto o : pendingRemoves) remove(o);
+    for (auto o : pendingAdds) add(o);
+    pendingRemoves.clear();
+    pendingAdds.clear();
+}
+
+void CollisionManager::add(ColliderEntity* o) {
+    objectIndices[o] = objects.size();
+    objects.push_back(o);
+    broad->add(o);
+}
+
+void CollisionManager::remove(ColliderEntity* o) {
+    const auto it = objectIndices.find(o);
+    if (it == end(objectIndices)) return;
+
+    // the last object takes the removed one's place
+    const auto index = it->second;
+    objectIndices.erase(it);
+    if (index != objects.size() - 1) {
+        objects[index] = objects.back();
+        objectIndices[objects[index]] = index;
+    }
+    objects.pop_back();
 
-	size_t numCollisions, maxIters = 8;
-	do {
-		collisionPairs = broadPhase();
-		numCollisions = narrowPhase(dt);
-	} while (numCollisions > 0 && --maxIters > 0);
+    broad->remove(o);
+    for (auto it = begin(contactCaches); it != end(contactCaches);) {
+        if (it->first.first == o || it->first.second == o)
+            it = contactCaches.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = begin(pairMethods); it != end(pairMethods);) {
+        if (it->first.first == o || it->first.second == o)
+            it = pairMethods.erase(it);
+        else
+            ++it;
+    }
 }
 
-void CollisionManager::draw() {
-#if DEBUG
-	//octTree->draw();
-#endif
+void CollisionManager::setBroadPhase(BroadPhase::Type type) {
+    applyPending();
+    broadType = type;
+    broad = BroadPhase::create(type);
+    contactCaches.clear();
+    for (auto o : objects)
+        broad->add(o);
 }
 
+void CollisionManager::setPairMethod(ColliderEntity* a, ColliderEntity* b, Collider::Method method) {
+    pairMethods[std::minmax(a, b)] = method;
+}
+
+void CollisionManager::clearPairMethod(ColliderEntity* a, ColliderEntity* b) {
+    pairMethods.erase(std::minmax(a, b));
+}
+
+// the broad and narrow phases only run once per tick; pairs that start overlapping because of a collision response are picked up next tick
+void CollisionManager::update(float dt) {
+    applyPending();
+
+    DebugBenchmark::start();
+    _stats.pairs = broadPhase().size();
+    _stats.broad = DebugBenchmark::end();
+
+    DebugBenchmark::start();
+    if (continuous) continuousPhase();
+    _stats.continuous = DebugBenchmark::end();
+
+    DebugBenchmark::start();
+    _stats.contacts = narrowPhase();
+    _stats.tested = testPairs.size();
+    _stats.narrow = DebugBenchmark::end();
+
+    DebugBenchmark::start();
+    buildIslands();
+    solveIslands(dt);
+    _stats.islands = islands.size();
+    _stats.solve = DebugBenchmark::end();
+
+    DebugBenchmark::start();
+    query.update(objects);
+    _stats.query = DebugBenchmark::end();
+}
+
+void CollisionManager::draw() {}
+
 void CollisionManager::clear()
 {
-	//octTree->clear();
-	objects = std::vector<ColliderEntity*>();
-}
-
-//returns a list of all pairs of colliders requiring narrow phase checks
-collisionPairList CollisionManager::broadPhase() {
-	//return octTree->checkCollisions();
-	return collisionPairs;
-}
-
-//returns the number of collisions found and handled
-size_t CollisionManager::narrowPhase(float dt) {
-	size_t numCollisions = 0;
-	for (auto& [a, b] : collisionPairs) {
-		//DebugBenchmark::start();
-		if (!(a->active && b->active) || !(a->rigidBody.solid() && b->rigidBody.solid()))
-			continue;
-
-		auto m = a->collider()->intersects(b->collider());
-		if (m.originator) {
-			if (m.originator == a->collider())
-				a->handleCollision(b, m, dt, numCollisions);
-			else
-				b->handleCollision(a, m, dt, numCollisions);
-			a->collider()->update();
-			b->collider()->update();
-			++numCollisions;
-
-			std::cout << "collision! " << a->id << ", " << b->id << "; " << (m.originator == a->collider() ? a->id : b->id) << ", "
-				<< m.pen << "; contact points: " << m.colPoints.size() << '\n';
-		}
-		//std::cout << "Collision Check Time: " << DebugBenchmark::end() << '\n';
-	}
-	return numCollisions;
-}
\ No newline at end of file
+    {
+        std::lock_guard<std::mutex> lock(pendingMut);
+        pendingAdds.clear();
+        pendingRemoves.clear();
+    }
+    broad->clear();
+    query.clear();
+    contactCaches.clear();
+    pairMethods.clear();
+    objects = std::vector<ColliderEntity*>();
+    objectIndices.clear();
+}
+
+//returns a list of all pairs of colliders requiring narrow phase checks, i.e. those with overlapping AABBs
+const collisionPairList& CollisionManager::broadPhase() {
+    broad->update();
+    for (const auto& pair : broad->removed())
+        contactCaches.erase(pair);
+    return broad->pairs();
+}
+
+/*
+----------------------------------------------------------------------
+- Continuous collision detection, for bodies that moved further than their radius in a single tick and so could have tunneled
+  - The broad phase already pairs them with everything their swept bounds touched
+  - Each such pair is swept from where both bodies started the tick to where they ended up, ignoring rotation
+- The sweep starts where the pair's bounding spheres first touch, as the colliders can't touch before that
+  - From there it advances conservatively: GJK finds the gap between the colliders, and the sweep skips ahead to when the relative motion
+    could first have closed it; the colliders are moved along without touching their transforms
+  - It stops once the gap is under CCD_TOLERANCE, and the hit is put a little past that, so the narrow phase finds the contact
+  - A sweep that hasn't converged after CCD_MAX_ITERATIONS stops at its last step, which is always clear of the other collider
+- Every fast body is moved back to the earliest hit found for it, keeping its velocity,
+  so the narrow phase finds the contact there and the solver resolves it as usual
+  - The rest of the tick's motion is dropped, and bodies are only moved back once per tick
+- This runs on the physics thread, as it moves colliders that other pairs may be testing
+----------------------------------------------------------------------
+*/
+size_t CollisionManager::continuousPhase() {
+    const auto& pairs = broad->pairs();
+    impactTimes.clear();
+    for (const auto [a, b] : pairs) {
+        if (!(a->active && b->active) || !(a->rigidBody.solid() && b->rigidBody.solid()))
+            continue;
+        if (!isFast(a) && !isFast(b))
+            continue;
+
+        const auto t = timeOfImpact(a, b);
+        if (t >= 1) continue;
+
+        if (impactTimes.empty()) impactTimes.assign(objects.size(), 1.f);
+        for (auto e : { a, b }) {
+            auto& impact = impactTimes[objectIndices[e]];
+            if (isDynamic(e)) impact = minf(impact, t);
+        }
+    }
+
+    size_t moved = 0;
+    for (size_t i = 0, n = impactTimes.size(); i < n; ++i) {
+        if (impactTimes[i] >= 1) continue;
+
+        auto e = objects[i];
+        e->transform.position = e->transform.position() - (1 - impactTimes[i]) * e->rigidBody.motion();
+        e->collider()->update();
+        ++moved;
+    }
+    return moved;
+}
+
+// the fraction of the pair's last move at which they first hit each other, or 1 if they didn't (or only did at the very end)
+float CollisionManager::timeOfImpact(ColliderEntity* a, ColliderEntity* b) const {
+    const auto colA = a->collider(), colB = b->collider();
+    const auto endA = colA->framePos(), endB = colB->framePos();
+    const auto moveA = a->rigidBody.motion(), moveB = b->rigidBody.motion();
+    const auto startA = endA - moveA, startB = endB - moveB;
+
+    // solves |offset + t * move| = radius for the first time the bounding spheres touch
+    const auto offset = startA - startB, move = moveA - moveB;
+    const auto radius = colA->radius() + colB->radius();
+    const auto moveSq = glm::dot(move, move);
+    if (moveSq < FLT_EPSILON) return 1;
+    const auto c = glm::dot(offset, offset) - radius * radius;
+    auto t = 0.f;
+    if (c > 0) {
+        const auto b2 = glm::dot(offset, move); // half of b
+        const auto disc = b2 * b2 - moveSq * c;
+        if (b2 >= 0 || disc < 0) return 1;
+        t = (-b2 - sqrtf(disc)) / moveSq;
+        if (t >= 1) return 1;
+    }
+
+    // conservative advancement: the pair can't touch before the gap between them closes along the line across it,
+    // so each step goes exactly that far, and the steps shrink as the pair closes in
+    auto hit = 1.f, closing = 0.f;
+    size_t i = 0;
+    for (; i < CCD_MAX_ITERATIONS && t < 1; ++i) {
+        colA->moveFrame(startA + t * moveA);
+        colB->moveFrame(startB + t * moveB);
+
+        vec3 gap;
+        const auto dist = GJK::distance(colA, colB, gap);
+        // pairs already touching at the start of the tick are left to the narrow phase
+        if (dist <= 0 && t == 0) break;
+        // once they touch there's no gap to go by, but the step that got them there was still closing at the same rate
+        if (dist > 0) {
+            closing = -glm::dot(move, gap) / dist; // how much of the gap the whole move closes
+            if (closing <= 0) break;
+        }
+
+        if (dist < CCD_TOLERANCE) {
+            // the hit is put just deep enough for the narrow phase to count it as a contact
+            hit = closing > 0 ? minf(t + (dist + CCD_DEPTH) / closing, 1.f) : t;
+            break;
+        }
+        t += dist / closing;
+    }
+    // the last step is still clear of the other collider, so it's a safe place to stop if the sweep runs out of iterations
+    if (i == CCD_MAX_ITERATIONS && t < 1) hit = t;
+
+    colA->moveFrame(endA);
+    colB->moveFrame(endB);
+    return hit;
+}
+
+/*
+----------------------------------------------------------------------
+- The narrow phase runs the intersection tests for every pair in parallel across the thread pool
+  - Each thread writes the manifolds it finds into its own buffer
+  - The tests only read collider data, which doesn't change until the contacts are solved
+  - Pairs that haven't moved relative to each other reuse their cached manifolds instead,
+    and pairs that weren't touching test the axis that last separated them first
+- Pairs without an awake body aren't tested at all; nothing about them can have changed since they went to sleep
+  - Pairs of sleeping bodies are remembered though, as they still hold their islands together
+- The contacts are sorted by pair, so the results don't depend on how the work was split up
+----------------------------------------------------------------------
+*/
+size_t CollisionManager::narrowPhase() {
+    const auto& pairs = broad->pairs();
+    testPairs.clear();
+    sleepingPairs.clear();
+    for (size_t i = 0, numPairs = pairs.size(); i < numPairs; ++i) {
+        const auto [a, b] = pairs[i];
+        if (!(a->active && b->active) || !(a->rigidBody.solid() && b->rigidBody.solid()))
+            continue;
+        if (!isAwake(a) && !isAwake(b)) {
+            if (isDynamic(a) && isDynamic(b)) sleepingPairs.push_back(i);
+            continue;
+        }
+
+        auto& cache = contactCaches[pairs[i]];
+        cache.beginTick();
+        testPairs.push_back({ i, &cache, pairMethod(a, b) });
+    }
+
+    findContacts();
+    return contacts.size();
+}
+
+Collider::Method CollisionManager::pairMethod(ColliderEntity* a, ColliderEntity* b) const {
+    if (pairMethods.size()) {
+        if (const auto it = pairMethods.find(std::minmax(a, b)); it != end(pairMethods)) return it->second;
+    }
+    return a->collider()->getPairMethod(b->collider());
+}
+
+void CollisionManager::findContacts() {
+    auto& pool = thread_pool::get();
+    threadContacts.resize(pool.size());
+    for (auto& buffer : threadContacts) buffer.clear();
+
+    const auto& pairs = broad->pairs();
+    const auto test = [&](size_t begin, size_t end, size_t thread) {
+        auto& buffer = threadContacts[thread];
+        for (auto i = begin; i < end; ++i) {
+            const auto [pair, cache, method] = testPairs[i];
+            const auto a = pairs[pair].first->collider(), b = pairs[pair].second->collider();
+
+            Manifold m;
+            if (!cacheContacts || !cache->reuse(a, b, m)) {
+                m = a->intersects(b, method, cacheContacts ? &cache->separatingAxis : nullptr);
+                cache->store(a, b, m);
+            }
+            if (m.originator) buffer.push_back({ pair, std::move(m), cache, true });
+        }
+    };
+
+    if (parallel)
+        pool.parallel_for(testPairs.size(), PARALLEL_GRAIN, test);
+    else
+        test(0, testPairs.size(), 0);
+
+    contacts.clear();
+    for (auto& buffer : threadContacts) {
+        std::move(begin(buffer), end(buffer), std::back_inserter(contacts));
+    }
+    std::sort(begin(contacts), end(contacts), [](const Contact& a, const Contact& b) { return a.pair < b.pair; });
+}
+
+/*
+----------------------------------------------------------------------
+- Bodies are grouped into simulation islands: sets of dynamic bodies connected by contacts
+  - Infinite mass bodies never join an island, as nothing a contact does can move them; otherwise the ground would link everything
+  - Each contact belongs to the island of its dynamic body (or bodies)
+- Islands don't share anything the solver writes to, so they're solved independently, in parallel
+- An island is woken up entirely if any of its bodies is awake or anything touched it this tick,
+  and is put to sleep entirely once every body in it has been resting for SLEEP_TIME
+- Islands are numbered by their first body, and keep their contacts in pair order, so the solve is deterministic
+----------------------------------------------------------------------
+*/
+void CollisionManager::buildIslands() {
+    const auto& pairs = broad->pairs();
+    const auto numObjects = objects.size();
+
+    islandSets.reset(numObjects);
+    const auto connect = [&](const BroadPhase::pair_t& pair) {
+        if (isDynamic(pair.first) && isDynamic(pair.second))
+            islandSets.unite(objectIndices[pair.first], objectIndices[pair.second]);
+    };
+    for (const auto& contact : contacts) connect(pairs[contact.pair]);
+    for (const auto pair : sleepingPairs) connect(pairs[pair]);
+
+    constexpr auto NO_ISLAND = SIZE_MAX;
+    bodyIslands.assign(numObjects, NO_ISLAND);
+    islands.clear();
+    for (size_t i = 0; i < numObjects; ++i) {
+        if (!objects[i]->active || !isDynamic(objects[i])) continue;
+
+        auto& island = bodyIslands[islandSets.find(i)];
+        if (island == NO_ISLAND) {
+            island = islands.size();
+            islands.push_back({});
+        }
+        bodyIslands[i] = island;
+        ++islands[island].numBodies;
+        islands[island].awake |= !objects[i]->rigidBody.asleep();
+    }
+
+    const auto contactIsland = [&](const Contact& contact) {
+        const auto [a, b] = pairs[contact.pair];
+        return bodyIslands[objectIndices[isDynamic(a) ? a : b]];
+    };
+    for (const auto& contact : contacts) {
+        if (isDynamic(pairs[contact.pair].first) || isDynamic(pairs[contact.pair].second)) {
+            auto& island = islands[contactIsland(contact)];
+            ++island.numContacts;
+            island.awake = true; // only pairs with an awake body are tested
+        }
+    }
+
+    // lays each island's bodies and contacts out contiguously
+    size_t bodyOffset = 0, contactOffset = 0;
+    for (auto& island : islands) {
+        island.firstBody = bodyOffset;
+        island.firstContact = contactOffset;
+        bodyOffset += island.numBodies;
+        contactOffset += island.numContacts;
+        island.numBodies = island.numContacts = 0;
+    }
+    islandBodies.resize(bodyOffset);
+    islandContacts.resize(contactOffset);
+
+    for (size_t i = 0; i < numObjects; ++i) {
+        if (bodyIslands[i] == NO_ISLAND) continue;
+
+        auto& island = islands[bodyIslands[i]];
+        auto body = objects[i];
+        islandBodies[island.firstBody + island.numBodies++] = body;
+        if (island.awake && body->rigidBody.asleep())
+            body->rigidBody.wake();
+    }
+    for (size_t i = 0, numContacts = contacts.size(); i < numContacts; ++i) {
+        const auto [a, b] = pairs[contacts[i].pair];
+        if (!isDynamic(a) && !isDynamic(b)) continue;
+
+        auto& island = islands[contactIsland(contacts[i])];
+        islandContacts[island.firstContact + island.numContacts++] = i;
+    }
+}
+
+/*
+----------------------------------------------------------------------
+- Sequential impulses: every contact in an island is solved on its own, one after the other, and the island is swept over several times
+  - Each pass corrects the velocities left by the others, converging on impulses that satisfy every contact at once
+  - The total impulse of each contact is clamped rather than each step, so later passes can take back impulse earlier ones overshot
+- On the first pass, contacts persisting from the last tick are warm started with the impulse they applied then
+- Torque and position correction only happen once per contact, after the velocities have been solved
+- The entities' collision hooks (see ColliderEntity::handleCollision) run first, one contact at a time on the physics thread,
+  as they're game code; only the solver itself runs in parallel
+  - They run in island order, and islands don't share any body a contact can push, so the built-in hook gives the same result as when it ran per island
+- Collider updates and sleeping happen on the physics thread afterwards, as updating a collider queues a debug draw, which isn't thread safe
+----------------------------------------------------------------------
+*/
+void CollisionManager::solveIslands(float dt) {
+    const auto& pairs = broad->pairs();
+
+    // entities are ordered with the manifold's originator first
+    const auto entities = [&](const Contact& contact) {
+        const auto [a, b] = pairs[contact.pair];
+        return contact.manifold.originator == a->collider() ? std::make_pair(a, b) : std::make_pair(b, a);
+    };
+
+    for (const auto& island : islands) {
+        if (!island.awake || !island.numContacts) continue;
+
+        const auto first = islandContacts.data() + island.firstContact, last = first + island.numContacts;
+        for (auto c = first; c != last; ++c) {
+            auto& contact = contacts[*c];
+            auto& m = contact.manifold;
+            m.impulse = cacheContacts ? contact.cache->warmStart(m) : 0;
+
+            const auto [a, b] = entities(contact);
+            contact.solved = a->handleCollision(b, m, dt);
+            if (!contact.solved) m.impulse = 0;
+        }
+    }
+
+    const auto solve = [&](size_t begin, size_t end, size_t) {
+        for (auto i = begin; i < end; ++i) {
+            const auto& island = islands[i];
+            if (!island.awake || !island.numContacts) continue;
+
+            const auto first = islandContacts.data() + island.firstContact, last = first + island.numContacts;
+            for (size_t iter = 0; iter < solverIterations; ++iter) {
+                for (auto c = first; c != last; ++c) {
+                    auto& contact = contacts[*c];
+                    if (!contact.solved) continue;
+
+                    const auto [a, b] = entities(contact);
+                    a->solveContact(b, contact.manifold);
+                }
+            }
+
+            for (auto c = first; c != last; ++c) {
+                auto& contact = contacts[*c];
+                if (contact.solved) {
+                    const auto [a, b] = entities(contact);
+                    a->applyContact(b, contact.manifold, dt);
+                }
+                contact.cache->accumulate(contact.manifold);
+            }
+        }
+    };
+
+    if (parallel)
+        thread_pool::get().parallel_for(islands.size(), 1, solve);
+    else
+        solve(0, islands.size(), 0);
+
+    for (const auto& island : islands) {
+        if (!island.awake) continue;
+
+        auto minRestTime = FLT_MAX;
+        for (size_t i = island.firstBody, last = i + island.numBodies; i < last; ++i) {
+            const auto body = islandBodies[i];
+            auto& rb = body->rigidBody;
+            if (island.numContacts) body->collider()->update(); // only contacts could have moved it since its physics update
+            rb.restTime = rb.resting() ? rb.restTime + dt : 0;
+            minRestTime = minf(minRestTime, rb.restTime);
+        }
+
+        if (allowSleeping && minRestTime >= SLEEP_TIME) {
+            for (size_t i = island.firstBody, last = i + island.numBodies; i < last; ++i)
+                islandBodies[i]->rigidBody.sleep();
+        }
+    }
+
+    if (!logContacts) return;
+    for (const auto& contact : contacts) {
+        const auto [a, b] = pairs[contact.pair];
+        const auto& m = contact.manifold;
+        for (const auto& colPoint : m.colPoints)
+            DrawDebug::get().drawDebugSphere(colPoint, 0.1f, vec3(1, 0, 0), 0.8f);
+
+        std::cout << "collision! " << a->id << ", " << b->id << "; " << (m.originator == a->collider() ? a->id : b->id) << ", "
+            << m.pen << "; contact points: " << m.colPoints.size() << '\n';
+    }
+}
@@ -1,29 +1,121 @@
 #pragma once
 
-//#include "OctTree.h"
+#include <mutex>
+#include <unordered_map>
+
+#include "thread_pool.h"
+#include "union_find.h"
+
+#include "BroadPhase.h"
+#include "CollisionQuery.h"
+#include "ContactCache.h"
 #include "ColliderEntity.h"
 
-typedef std::vector<std::pair<ColliderEntity*, ColliderEntity*>> collisionPairList;
+typedef BroadPhase::pair_list collisionPairList;
 
 class CollisionManager
 {
 public:
-	static CollisionManager& getInstance() { static CollisionManager instance; return instance; }
+    static CollisionManager& getInstance() { static CollisionManager instance; return instance; }
+
+    // these can be called from any thread; the entity only joins or leaves the world at the start of the next update,
+    // so nothing the physics thread is iterating over changes under it
+    // removed entities are dropped from queries straight away, and destroying one waits out a running tick (see RigidBodyWorld::tickMutex)
+    void addEntity(ColliderEntity* o);
+    void removeEntity(ColliderEntity* o);
+    void update(float dt);
+    void draw();
+    void clear();
+
+    // swaps out the broad phase implementation, re-adding all the current objects to the new one
+    void setBroadPhase(BroadPhase::Type type);
+    // drops everything carried over between ticks (contact caches, and the order of the broad phase's pairs),
+    // so the next tick only depends on the bodies themselves, as if the scene had just been built
+    void resetCaches() { setBroadPhase(broadType); }
+
+    // overrides the contact method for a specific pair, regardless of the methods set for their collider types
+    void setPairMethod(ColliderEntity* a, ColliderEntity* b, Collider::Method method);
+    void clearPairMethod(ColliderEntity* a, ColliderEntity* b);
+
+    // spatial queries over the world as of the end of the last update; these can be called from any thread (see CollisionQuery)
+    CollisionQuery::Hit raycast(const CollisionQuery::Ray& ray) const { return query.raycast(ray); }
+    CollisionQuery::Hit sphereCast(const CollisionQuery::Ray& ray, float radius) const { return query.sphereCast(ray, radius); }
+    void overlapAABB(const AABB& bounds, std::vector<ColliderEntity*>& found) const { query.overlapAABB(bounds, found); }
+    void raycast(const std::vector<CollisionQuery::Ray>& rays, std::vector<CollisionQuery::Hit>& hits) const { query.raycast(rays, hits); }
+
+    const collisionPairList& broadPhase();
+    // moves fast bodies back to where they first hit something along their last move, returning the number of bodies moved
+    size_t continuousPhase();
+    // tests every pair with an awake body, returning the number of contacts found
+    size_t narrowPhase();
 
-	void addEntity(ColliderEntity* o);
-	void update(float dt);
-	void draw();
-	void clear();
+    // the intersection tests are split across the thread pool once there are at least this many pairs to test
+    static constexpr size_t PARALLEL_GRAIN = 16;
+    bool parallel = true;
+    // reuse manifolds for pairs that haven't moved relative to each other, and carry impulses over between ticks
+    bool cacheContacts = true;
 
-	collisionPairList broadPhase();
-	size_t narrowPhase(float dt);
+    // bodies that moved further than their collider's radius in a tick are swept for hits they could have passed through
+    bool continuous = true;
+    // how close a sweep has to get to count as a hit, and the most steps a sweep can take before it gives up and stops short
+    static constexpr float CCD_TOLERANCE = 0.01f;
+    static constexpr size_t CCD_MAX_ITERATIONS = 32;
+    // how deep the hit is put, so the contact is deeper than the narrow phase's tolerance
+    static constexpr float CCD_DEPTH = -2 * Collider::PEN_TOLERANCE;
+
+    // the number of times the solver iterates over an island's contacts each tick
+    size_t solverIterations = 8;
+    // how long every body in an island has to stay under MIN_VEL before the island is put to sleep
+    static constexpr float SLEEP_TIME = 0.5f;
+    bool allowSleeping = true;
+
+    // draws and prints every contact found each tick, which gets very slow with more than a handful of bodies
+    bool logContacts = true;
+
+    // what the last update did, and how long each of its phases took in milliseconds
+    struct Stats {
+        double broad = 0, continuous = 0, narrow = 0, solve = 0, query = 0;
+        size_t pairs = 0, tested = 0, contacts = 0, islands = 0;
+    };
+    const Stats& stats() const { return _stats; }
 
 private:
-	CollisionManager();
-	//~CollisionManager();
+    CollisionManager();
+
+    struct TestPair { size_t pair; ContactCache* cache; Collider::Method method; };
+    struct Contact { size_t pair; Manifold manifold; ContactCache* cache; bool solved; };
+    // ranges into islandBodies and islandContacts
+    struct Island { size_t firstBody, numBodies, firstContact, numContacts; bool awake; };
+    void applyPending();
+    void add(ColliderEntity* o);
+    void remove(ColliderEntity* o);
+    Collider::Method pairMethod(ColliderEntity* a, ColliderEntity* b) const;
+    float timeOfImpact(ColliderEntity* a, ColliderEntity* b) const;
+    void findContacts();
+    void buildIslands();
+    void solveIslands(float dt);
+
+    std::mutex pendingMut;
+    std::vector<ColliderEntity*> pendingAdds, pendingRemoves; // guarded by pendingMut
+    std::vector<ColliderEntity*> objects;
+    std::unordered_map<ColliderEntity*, size_t> objectIndices;
+    BroadPhase::Type broadType = BroadPhase::Type::SWEEP_AND_PRUNE;
+    unique<BroadPhase::Base> broad;
+    std::unordered_map<BroadPhase::pair_t, ContactCache, BroadPhase::pair_hash> contactCaches;
+    std::unordered_map<BroadPhase::pair_t, Collider::Method, BroadPhase::pair_hash> pairMethods; // keyed with the lower address first
+
+    std::vector<float> impactTimes; // the earliest hit found for each object this tick, as a fraction of its move
+    std::vector<TestPair> testPairs;
+    std::vector<std::vector<Contact>> threadContacts; // each pool thread writes to its own buffer, so no locking is needed
+    std::vector<Contact> contacts;
 
-	//OctTree* octTree;
-	std::vector<ColliderEntity*> objects;
-	collisionPairList collisionPairs;
+    std::vector<size_t> sleepingPairs; // untested pairs between sleeping bodies, which still connect their islands
+    union_find islandSets;
+    std::vector<size_t> bodyIslands;
+    std::vector<Island> islands;
+    std::vector<ColliderEntity*> islandBodies;
+    std::vector<size_t> islandContacts;
 
+    CollisionQuery query;
+    Stats _stats;
 };
@@ -0,0 +1,291 @@
+#include "CollisionQuery.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "ColliderEntity.h"
+
+using BroadPhase::Bounds;
+
+namespace {
+    // slab test of a ray against bounds grown by [radius]; a direction component of 0 gives an infinite inverse, which the test handles
+    inline bool castBounds(const Bounds& bounds, float radius, const vec3 origin, const vec3 invDir, float maxDist) {
+        const auto t0 = (bounds.min - vec3(radius) - origin) * invDir;
+        const auto t1 = (bounds.max + vec3(radius) - origin) * invDir;
+        const auto tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+        const auto tEnter = maxf(maxf(tMin.x, tMin.y), tMin.z);
+        const auto tExit  = minf(minf(tMax.x, tMax.y), tMax.z);
+        return tExit >= maxf(tEnter, 0) && tEnter <= maxDist;
+    }
+
+    inline vec3 center(const Bounds& bounds) { return (bounds.min + bounds.max) * 0.5f; }
+}
+
+void CollisionQuery::update(const std::vector<ColliderEntity*>& objects) {
+    if (!queried.exchange(false, std::memory_order_relaxed)) return;
+    {
+        // anything removed from here on may still be in [objects] as it's read, so it's dropped again before the swap
+        std::unique_lock<std::shared_mutex> lock(mut);
+        rebuilding = true;
+    }
+
+    // nothing reads the back buffer, so it can be rebuilt without locking
+    auto& snap = front == &snapshots[0] ? snapshots[1] : snapshots[0];
+    snap.shapes.clear();
+    snap.bounds.clear();
+    snap.planes.clear();
+    snap.nodes.clear();
+
+    for (auto e : objects) {
+        if (!e->active) continue;
+
+        const auto c = e->collider();
+        Shape shape { e, c, c->type(), c->framePos(), c->dims() * c->frameScale(), c->frameRot(), c->radius(), (uint32_t)snap.planes.size(), 0 };
+        if (shape.type == Collider::Type::MESH) c->getFacePlanes(snap.planes);
+        shape.numPlanes = (uint32_t)snap.planes.size() - shape.firstPlane;
+        snap.shapes.push_back(shape);
+        snap.bounds.emplace_back(c->aabb());
+    }
+
+    const auto numShapes = (uint32_t)snap.shapes.size();
+    snap.order.resize(numShapes);
+    std::iota(begin(snap.order), end(snap.order), 0u);
+    if (numShapes) build(snap, 0, numShapes);
+
+    std::unique_lock<std::shared_mutex> lock(mut);
+    for (auto entity : removed) drop(snap, entity);
+    removed.clear();
+    rebuilding = false;
+    front = &snap;
+}
+
+void CollisionQuery::remove(const ColliderEntity* entity) {
+    std::unique_lock<std::shared_mutex> lock(mut);
+    drop(*front, entity);
+    if (rebuilding) removed.push_back(entity);
+}
+
+void CollisionQuery::clear() {
+    std::unique_lock<std::shared_mutex> lock(mut);
+    for (auto& snap : snapshots) snap = Snapshot();
+    removed.clear();
+    queried = true;
+}
+
+// leaves the shape in the hierarchy, as the tree is rebuilt soon enough, but nothing hits it any more
+void CollisionQuery::drop(Snapshot& snap, const ColliderEntity* entity) {
+    for (auto& shape : snap.shapes) {
+        if (shape.entity == entity) shape.entity = nullptr;
+    }
+}
+
+// splits at the median of the shapes' centers along the axis they're most spread out on, returning the index of the new node
+uint32_t CollisionQuery::build(Snapshot& snap, uint32_t first, uint32_t count) {
+    const auto node = (uint32_t)snap.nodes.size();
+    snap.nodes.emplace_back();
+
+    auto bounds = snap.bounds[snap.order[first]];
+    Bounds centers;
+    centers.min = centers.max = center(bounds);
+    for (auto i = first + 1, last = first + count; i < last; ++i) {
+        const auto& shapeBounds = snap.bounds[snap.order[i]];
+        bounds = Bounds::merge(bounds, shapeBounds);
+        centers.min = glm::min(centers.min, center(shapeBounds));
+        centers.max = glm::max(centers.max, center(shapeBounds));
+    }
+
+    if (count <= LEAF_SIZE) {
+        snap.nodes[node] = { bounds, first, count };
+        return node;
+    }
+
+    const auto spread = centers.max - centers.min;
+    const auto axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+    const auto mid = first + count / 2;
+    const auto order = snap.order.data();
+    std::nth_element(order + first, order + mid, order + first + count, [&](uint32_t a, uint32_t b) {
+        return center(snap.bounds[a])[axis] < center(snap.bounds[b])[axis];
+    });
+
+    build(snap, first, mid - first); // the left child always comes right after its parent
+    const auto right = build(snap, mid, first + count - mid);
+    snap.nodes[node] = { bounds, right, 0 };
+    return node;
+}
+
+CollisionQuery::Hit CollisionQuery::raycast(const Ray& ray) const {
+    queried.store(true, std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mut);
+    return cast(*front, ray, 0);
+}
+
+CollisionQuery::Hit CollisionQuery::sphereCast(const Ray& ray, float radius) const {
+    queried.store(true, std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mut);
+    return cast(*front, ray, radius);
+}
+
+void CollisionQuery::raycast(const std::vector<Ray>& rays, std::vector<Hit>& hits) const {
+    hits.resize(rays.size());
+
+    queried.store(true, std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mut);
+    for (size_t i = 0, n = rays.size(); i < n; ++i)
+        hits[i] = cast(*front, rays[i], 0);
+}
+
+void CollisionQuery::overlapAABB(const AABB& aabb, std::vector<ColliderEntity*>& found) const {
+    const Bounds bounds(aabb);
+
+    queried.store(true, std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mut);
+    const auto& snap = *front;
+    if (snap.nodes.empty()) return;
+
+    uint32_t stack[MAX_DEPTH];
+    size_t size = 0;
+    stack[size++] = 0;
+    while (size) {
+        const auto index = stack[--size];
+        const auto& node = snap.nodes[index];
+        if (!node.bounds.overlaps(bounds)) continue;
+
+        if (node.isLeaf()) {
+            for (auto i = node.first, last = node.first + node.count; i < last; ++i) {
+                const auto shape = snap.order[i];
+                if (snap.shapes[shape].entity && snap.bounds[shape].overlaps(bounds)) found.push_back(snap.shapes[shape].entity);
+            }
+        }
+        else {
+            stack[size++] = node.first;
+            stack[size++] = index + 1;
+        }
+    }
+}
+
+// finds the closest hit along the ray, shrinking the ray to each hit as it goes so further nodes get culled
+CollisionQuery::Hit CollisionQuery::cast(const Snapshot& snap, const Ray& ray, float radius) {
+    Hit hit;
+    const auto length = glm::length(ray.dir);
+    if (length < FLT_EPSILON || snap.nodes.empty()) return hit;
+
+    const auto dir = ray.dir / length;
+    const auto invDir = 1.f / dir;
+    auto maxDist = ray.maxDist;
+
+    uint32_t stack[MAX_DEPTH];
+    size_t size = 0;
+    stack[size++] = 0;
+    while (size) {
+        const auto index = stack[--size];
+        const auto& node = snap.nodes[index];
+        if (!castBounds(node.bounds, radius, ray.origin, invDir, maxDist)) continue;
+
+        if (node.isLeaf()) {
+            for (auto i = node.first, last = node.first + node.count; i < last; ++i) {
+                const auto& shape = snap.shapes[snap.order[i]];
+                if (shape.entity && shape.entity != ray.ignore && castShape(snap, shape, ray.origin, dir, radius, maxDist, hit))
+                    maxDist = hit.distance;
+            }
+        }
+        else {
+            stack[size++] = node.first;
+            stack[size++] = index + 1;
+        }
+    }
+    return hit;
+}
+
+// fills in [hit] and returns true if the ray (or sphere of [radius]) along the normalized [dir] hits the shape within [maxDist]
+bool CollisionQuery::castShape(const Snapshot& snap, const Shape& shape, const vec3 origin, const vec3 dir, float radius, float maxDist, Hit& hit) {
+    auto t = 0.f;
+    auto normal = -dir;
+
+    switch (shape.type) {
+    case Collider::Type::SPHERE: {
+        const auto r = shape.radius + radius;
+        const auto offset = origin - shape.center;
+        const auto c = glm::dot(offset, offset) - r * r;
+        if (c > 0) {
+            const auto b = glm::dot(offset, dir);
+            const auto disc = b * b - c;
+            if (b > 0 || disc < 0) return false;
+            t = -b - sqrtf(disc);
+            normal = (offset + t * dir) / r;
+        }
+        break;
+    }
+    case Collider::Type::BOX: {
+        // slab test in the box's space
+        const auto toLocal = glm::transpose(shape.axes);
+        const auto localOrigin = toLocal * (origin - shape.center), localDir = toLocal * dir;
+        const auto halfDims = shape.halfDims + vec3(radius);
+
+        auto tEnter = -FLT_MAX, tExit = FLT_MAX;
+        auto enterAxis = -1;
+        auto enterSign = 1.f;
+        for (auto k = 0; k < 3; ++k) {
+            if (std::abs(localDir[k]) < FLT_EPSILON) {
+                if (std::abs(localOrigin[k]) > halfDims[k]) return false;
+                continue;
+            }
+            const auto t0 = (-halfDims[k] - localOrigin[k]) / localDir[k];
+            const auto t1 = ( halfDims[k] - localOrigin[k]) / localDir[k];
+            if (minf(t0, t1) > tEnter) {
+                tEnter = minf(t0, t1);
+                enterAxis = k;
+                enterSign = localDir[k] > 0 ? -1.f : 1.f;
+            }
+            tExit = minf(tExit, maxf(t0, t1));
+        }
+        if (tEnter > tExit || tExit < 0) return false;
+
+        if (tEnter > 0) {
+            t = tEnter;
+            normal = shape.axes[enterAxis] * enterSign;
+        }
+        break;
+    }
+    case Collider::Type::MESH: {
+        // clips the ray against every face plane; the ray enters through the plane it crosses last going in
+        auto tEnter = -FLT_MAX, tExit = FLT_MAX;
+        for (auto i = shape.firstPlane, last = i + shape.numPlanes; i < last; ++i) {
+            const auto plane = snap.planes[i];
+            const auto n = vec3(plane);
+            const auto denom = glm::dot(n, dir);
+            const auto dist = plane.w + radius - glm::dot(n, origin); // positive on the inside
+
+            if (std::abs(denom) < FLT_EPSILON) {
+                if (dist < 0) return false;
+                continue;
+            }
+            const auto tPlane = dist / denom;
+            if (denom < 0) {
+                if (tPlane > tEnter) {
+                    tEnter = tPlane;
+                    normal = n;
+                }
+            }
+            else
+                tExit = minf(tExit, tPlane);
+            if (tEnter > tExit) return false;
+        }
+        if (tExit < 0) return false;
+
+        if (tEnter > 0)
+            t = tEnter;
+        else
+            normal = -dir;
+        break;
+    }
+    }
+
+    if (t > maxDist) return false;
+
+    hit.entity = shape.entity;
+    hit.collider = shape.collider;
+    hit.point = origin + t * dir;
+    hit.normal = normal;
+    hit.distance = t;
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "BroadPhase.h"
+
+/*
+----------------------------------------------------------------------
+- Answers spatial queries about the collision world (raycasts, sphere casts, and AABB overlaps) from any thread
+- The physics thread rebuilds a snapshot of every active collider at the end of each tick,
+  so queries never touch the colliders or the broad phase while they're being updated
+  - Each snapshot holds the colliders' shapes in world space, and a bounding volume hierarchy over their bounds
+  - It's built into a second buffer and swapped in under a lock, so queries only ever wait for the swap
+  - It's only rebuilt if something queried it since the last rebuild, so worlds nobody queries don't pay for it
+  - Queries made every tick see the world as of the end of the last tick;
+    the first one after a pause sees it as of the last rebuild, and the world catches up the tick after
+- Entities removed from the world are dropped from the snapshot straight away, without waiting for a rebuild
+- Shapes are tested exactly for rays: spheres analytically, boxes against their slabs, and meshes against their face planes
+  - Sphere casts grow each shape by the sphere's radius, which for boxes and meshes overestimates it around the edges and corners
+- Entities are returned as pointers, so destroying entities that queries have just returned is up to the caller to avoid
+----------------------------------------------------------------------
+*/
+class CollisionQuery {
+public:
+    struct Ray {
+        vec3 origin, dir; // the direction doesn't need to be normalized
+        float maxDist = FLT_MAX;
+        const ColliderEntity* ignore = nullptr; // e.g. the entity the ray is cast from
+    };
+
+    struct Hit {
+        ColliderEntity* entity = nullptr;
+        Collider* collider = nullptr;
+        vec3 point, normal; // rays starting inside a shape hit it at their origin, with the normal facing back along the ray
+        float distance = FLT_MAX;
+
+        explicit operator bool() const { return entity != nullptr; }
+    };
+
+    // rebuilds the snapshot from the colliders of [objects] if anything queried it since the last rebuild; physics thread only
+    void update(const std::vector<ColliderEntity*>& objects);
+    // drops the entity from the snapshot, including one that's being rebuilt, so queries stop returning it
+    void remove(const ColliderEntity* entity);
+    void clear();
+
+    Hit raycast(const Ray& ray) const;
+    // casts a sphere of [radius] from the ray's origin; the hit point is the sphere's center when it hit
+    Hit sphereCast(const Ray& ray, float radius) const;
+    // appends every entity whose bounds overlap [bounds]
+    void overlapAABB(const AABB& bounds, std::vector<ColliderEntity*>& found) const;
+    // casts every ray under a single lock; hits[i] is set to the hit for rays[i]
+    void raycast(const std::vector<Ray>& rays, std::vector<Hit>& hits) const;
+
+private:
+    struct Shape {
+        ColliderEntity* entity; // null once the entity has been removed
+        Collider* collider;
+        Collider::Type type;
+        vec3 center, halfDims; // boxes use halfDims along their axes
+        mat3 axes;
+        float radius;
+        uint32_t firstPlane, numPlanes; // meshes only
+    };
+
+    // interior nodes keep their left child right after them, and the index of the right child in [first]
+    struct Node {
+        BroadPhase::Bounds bounds;
+        uint32_t first, count; // leaves have a count of shapes, starting at [first] in the shape order
+        bool isLeaf() const { return count != 0; }
+    };
+
+    struct Snapshot {
+        std::vector<Shape> shapes;
+        std::vector<BroadPhase::Bounds> bounds;
+        std::vector<vec4> planes;
+        std::vector<uint32_t> order; // shape indices, grouped by leaf
+        std::vector<Node> nodes;
+    };
+
+    static constexpr uint32_t LEAF_SIZE = 4;
+    static constexpr size_t MAX_DEPTH = 64; // the tree is split at the median, so it can't get anywhere near this deep
+
+    static uint32_t build(Snapshot& snap, uint32_t first, uint32_t count);
+    static Hit cast(const Snapshot& snap, const Ray& ray, float radius);
+    static bool castShape(const Snapshot& snap, const Shape& shape, vec3 origin, vec3 dir, float radius, float maxDist, Hit& hit);
+    static void drop(Snapshot& snap, const ColliderEntity* entity);
+
+    Snapshot snapshots[2];
+    Snapshot* front = &snapshots[0];
+    mutable std::shared_mutex mut;
+    mutable std::atomic<bool> queried { true }; // starts off set, so there's something to query from the first tick on
+    // entities removed while the back buffer is being rebuilt, as it may have picked them up anyway; both guarded by mut
+    std::vector<const ColliderEntity*> removed;
+    bool rebuilding = false;
+};
@@ -0,0 +1,56 @@
+#include "ContactCache.h"
+
+// pose of b in the space of a; the rotations are pure rotations, so their transposes are their inverses
+ContactCache::Pose ContactCache::relativePose(Collider* a, Collider* b) {
+    const auto invRot = glm::transpose(a->frameRot());
+    return { invRot * (b->framePos() - a->framePos()), invRot * b->frameRot() };
+}
+
+bool ContactCache::reuse(Collider* a, Collider* b, Manifold& m) const {
+    if (!cached) return false;
+
+    const auto curr = relativePose(a, b);
+    const auto dPos = glm::abs(curr.pos - pose.pos);
+    if (maxf(maxf(dPos.x, dPos.y), dPos.z) > POS_TOLERANCE) return false;
+    for (auto i = 0; i < 3; ++i) {
+        const auto dRot = glm::abs(curr.rot[i] - pose.rot[i]);
+        if (maxf(maxf(dRot.x, dRot.y), dRot.z) > ROT_TOLERANCE) return false;
+    }
+
+    // the pair hasn't moved relative to each other, so only the frame of a has to be reapplied
+    const auto rot = a->frameRot();
+    const auto pos = a->framePos();
+
+    m = manifold;
+    m.axis = rot * m.axis;
+    for (auto& colPoint : m.colPoints)
+        colPoint = rot * colPoint + pos;
+    return true;
+}
+
+void ContactCache::store(Collider* a, Collider* b, const Manifold& m) {
+    cached = m.originator != nullptr;
+    if (!cached) return;
+
+    pose = relativePose(a, b);
+
+    const auto invRot = glm::transpose(a->frameRot());
+    const auto pos = a->framePos();
+
+    manifold = m;
+    manifold.impulse = 0;
+    manifold.axis = invRot * manifold.axis;
+    for (auto& colPoint : manifold.colPoints)
+        colPoint = invRot * (colPoint - pos);
+}
+
+float ContactCache::warmStart(const Manifold& m) const {
+    if (m.originator != originator || m.feature != feature) return 0;
+    return lastImpulse * WARM_START_FACTOR;
+}
+
+void ContactCache::accumulate(const Manifold& m) {
+    originator = m.originator;
+    feature = m.feature;
+    impulse += m.impulse;
+}
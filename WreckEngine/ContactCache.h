@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Collider.h"
+
+/*
+----------------------------------------------------------------------
+- Persistent contact data for a single collider pair, kept by the collision manager for as long as the broad phase reports the pair
+- Resting contacts barely move relative to each other from tick to tick, which this takes advantage of in two ways:
+  - If the pair's relative pose hasn't changed since its last manifold was generated, that manifold is reused as is,
+    skipping SAT and clipping entirely
+    - The manifold is stored in the space of the first collider, so pairs moving together can still reuse it
+  - The impulse applied by a contact is carried over to the next tick when the contact is generated from the same features (warm starting)
+    - This starts resting contacts close to the impulse that keeps them at rest, rather than letting them sink and pushing them back out
+- Pairs that aren't touching remember the axis that separated them instead, which is tested before running the full SAT
+- An entry is only ever touched by one thread at a time; the narrow phase gives each pair to a single worker, and the solver each island
+----------------------------------------------------------------------
+*/
+class ContactCache {
+public:
+    // how far the relative pose can drift before the cached manifold is considered stale
+    static constexpr float POS_TOLERANCE = 0.0005f, ROT_TOLERANCE = 0.0005f;
+    // the portion of last tick's impulse that's applied up front; less than 1 so stale impulses die out
+    static constexpr float WARM_START_FACTOR = 0.8f;
+
+    // fills in [m] and returns true if the manifold cached for [a] and [b] is still valid for their current poses
+    bool reuse(Collider* a, Collider* b, Manifold& m) const;
+    // records the manifold generated for the current poses of [a] and [b]; an empty manifold clears the cache
+    void store(Collider* a, Collider* b, const Manifold& m);
+
+    // moves the impulse accumulated over the last tick aside so this tick can accumulate its own
+    void beginTick() { lastImpulse = impulse; impulse = 0; }
+    // the impulse to warm start [m] with, which is only non-zero if it was generated from the same features as last tick's contact
+    float warmStart(const Manifold& m) const;
+    // adds the impulse applied by a resolved manifold to this tick's total
+    void accumulate(const Manifold& m);
+
+    // the axis that separated the pair the last time it was tested, if it wasn't touching
+    SeparatingAxis separatingAxis;
+
+private:
+    struct Pose { vec3 pos; mat3 rot; };
+    static Pose relativePose(Collider* a, Collider* b);
+
+    bool cached = false;
+    Manifold manifold; // contact points and axis are in the space of the first collider
+    Pose pose;
+
+    Collider* originator = nullptr;
+    ContactFeature feature;
+    float impulse = 0, lastImpulse = 0;
+};
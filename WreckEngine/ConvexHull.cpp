@@ -0,0 +1,292 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    struct HullFace {
+        std::array<GLuint, 3> verts;
+        vec3 normal;
+        float offset;
+        std::vector<GLuint> outside; // the points this face is the first to see
+        bool alive = true;
+
+        float distance(const vec3 p) const { return glm::dot(normal, p) - offset; }
+    };
+
+    HullFace makeFace(const std::vector<vec3>& points, GLuint a, GLuint b, GLuint c) {
+        HullFace face;
+        face.verts = { a, b, c };
+        const auto normal = glm::cross(points[b] - points[a], points[c] - points[a]);
+        const auto length = glm::length(normal);
+        face.normal = length > 0 ? normal / length : vec3();
+        face.offset = glm::dot(face.normal, points[a]);
+        return face;
+    }
+
+    inline uint64_t edgeKey(GLuint a, GLuint b) { return ((uint64_t)a << 32) | b; }
+
+    // hands each point to the first face that can see it; points no face can see are inside the hull, and are dropped
+    void assignPoints(const std::vector<vec3>& points, const std::vector<GLuint>& candidates, std::vector<HullFace>& faces, size_t firstFace, float eps) {
+        for (const auto p : candidates) {
+            for (auto f = firstFace, numFaces = faces.size(); f < numFaces; ++f) {
+                if (faces[f].distance(points[p]) > eps) {
+                    faces[f].outside.push_back(p);
+                    break;
+                }
+            }
+        }
+    }
+
+    // the planes of a hull mesh's triangles, as (outward normal, distance from the origin)
+    std::vector<vec4> hullPlanes(const Mesh& hull) {
+        const auto& verts = hull.data().verts;
+        const auto& tris = hull.indices().verts;
+        std::vector<vec4> planes;
+        planes.reserve(tris.size() / 3);
+        for (size_t i = 0, n = tris.size(); i < n; i += 3) {
+            const auto normal = glm::normalize(glm::cross(verts[tris[i + 1]] - verts[tris[i]], verts[tris[i + 2]] - verts[tris[i]]));
+            planes.push_back(vec4(normal, glm::dot(normal, verts[tris[i]])));
+        }
+        return planes;
+    }
+}
+
+shared<Mesh> ConvexHull::build(const Mesh& mesh) {
+    return build(mesh.data().verts);
+}
+
+shared<Mesh> ConvexHull::build(const std::vector<vec3>& points) {
+    const auto numPoints = points.size();
+    if (numPoints < 4) return nullptr;
+
+    // the tolerance scales with the magnitude of the coordinates, like the error of the plane tests does
+    vec3 maxAbs;
+    std::array<GLuint, 6> extremes {}; // the min and max point on each axis
+    for (GLuint i = 0; i < numPoints; ++i) {
+        const auto& p = points[i];
+        maxAbs = glm::max(maxAbs, glm::abs(p));
+        for (auto k = 0; k < 3; ++k) {
+            if (p[k] < points[extremes[k * 2]][k])     extremes[k * 2] = i;
+            if (p[k] > points[extremes[k * 2 + 1]][k]) extremes[k * 2 + 1] = i;
+        }
+    }
+    const auto eps = 3 * FLT_EPSILON * (maxAbs.x + maxAbs.y + maxAbs.z);
+
+    // the initial tetrahedron: the two most distant extremes, the point furthest from the line through them, and the point furthest from that plane
+    GLuint a = 0, b = 0;
+    auto maxDist = 0.f;
+    for (auto i = 0; i < 6; ++i) {
+        for (auto j = i + 1; j < 6; ++j) {
+            const auto dist = glm::length(points[extremes[i]] - points[extremes[j]]);
+            if (dist > maxDist) {
+                maxDist = dist;
+                a = extremes[i];
+                b = extremes[j];
+            }
+        }
+    }
+    if (maxDist <= eps) return nullptr;
+
+    GLuint c = 0;
+    maxDist = 0;
+    const auto line = glm::normalize(points[b] - points[a]);
+    for (GLuint i = 0; i < numPoints; ++i) {
+        const auto offset = points[i] - points[a];
+        const auto dist = glm::length(offset - line * glm::dot(offset, line));
+        if (dist > maxDist) {
+            maxDist = dist;
+            c = i;
+        }
+    }
+    if (maxDist <= eps) return nullptr;
+
+    GLuint d = 0;
+    maxDist = 0;
+    const auto base = makeFace(points, a, b, c);
+    for (GLuint i = 0; i < numPoints; ++i) {
+        const auto dist = std::abs(base.distance(points[i]));
+        if (dist > maxDist) {
+            maxDist = dist;
+            d = i;
+        }
+    }
+    if (maxDist <= eps) return nullptr;
+
+    std::vector<HullFace> faces;
+    const auto centroid = (points[a] + points[b] + points[c] + points[d]) * 0.25f;
+    for (const auto& tri : { std::array<GLuint, 3>{ a, b, c }, { a, d, b }, { b, d, c }, { c, d, a } }) {
+        auto face = makeFace(points, tri[0], tri[1], tri[2]);
+        if (face.distance(centroid) > 0) face = makeFace(points, tri[0], tri[2], tri[1]);
+        faces.push_back(face);
+    }
+
+    std::vector<GLuint> candidates;
+    candidates.reserve(numPoints);
+    for (GLuint i = 0; i < numPoints; ++i) {
+        if (i != a && i != b && i != c && i != d) candidates.push_back(i);
+    }
+    assignPoints(points, candidates, faces, 0, eps);
+
+    std::vector<size_t> visible;
+    std::unordered_set<uint64_t> visibleEdges;
+    std::vector<std::pair<GLuint, GLuint>> horizon;
+    for (size_t curr = 0; curr < faces.size(); ++curr) {
+        if (!faces[curr].alive || faces[curr].outside.empty()) continue;
+
+        // the eye point is the one furthest outside the face
+        const auto& outside = faces[curr].outside;
+        const auto eye = *std::max_element(begin(outside), end(outside), [&](GLuint p, GLuint q) {
+            return faces[curr].distance(points[p]) < faces[curr].distance(points[q]);
+        });
+
+        visible.clear();
+        visibleEdges.clear();
+        for (size_t f = 0, numFaces = faces.size(); f < numFaces; ++f) {
+            if (!faces[f].alive || faces[f].distance(points[eye]) <= eps) continue;
+            visible.push_back(f);
+            for (auto k = 0; k < 3; ++k)
+                visibleEdges.insert(edgeKey(faces[f].verts[k], faces[f].verts[(k + 1) % 3]));
+        }
+
+        // the horizon is made of the visible faces' edges that border a face that isn't visible
+        horizon.clear();
+        candidates.clear();
+        for (const auto f : visible) {
+            auto& face = faces[f];
+            for (auto k = 0; k < 3; ++k) {
+                const auto from = face.verts[k], to = face.verts[(k + 1) % 3];
+                if (!visibleEdges.count(edgeKey(to, from))) horizon.push_back({ from, to });
+            }
+            for (const auto p : face.outside) {
+                if (p != eye) candidates.push_back(p);
+            }
+            face.alive = false;
+            face.outside = std::vector<GLuint>();
+        }
+
+        // the new faces keep the winding of the faces they replace
+        const auto firstNew = faces.size();
+        for (const auto& edge : horizon)
+            faces.push_back(makeFace(points, edge.first, edge.second, eye));
+        assignPoints(points, candidates, faces, firstNew, eps);
+    }
+
+    Mesh::FaceData data;
+    Mesh::FaceIndex indices;
+    std::unordered_map<GLuint, GLuint> remap;
+    for (const auto& face : faces) {
+        if (!face.alive) continue;
+        for (const auto v : face.verts) {
+            const auto it = remap.insert({ v, (GLuint)data.verts.size() });
+            if (it.second) data.verts.push_back(points[v]);
+            indices.verts.push_back(it.first->second);
+        }
+    }
+    return make_shared<Mesh>(data, indices);
+}
+
+std::vector<ConvexHull::Piece> ConvexHull::decompose(const Mesh& mesh, const DecompositionSettings& settings) {
+    const auto& verts = mesh.data().verts;
+    const auto& tris = mesh.indices().verts;
+
+    struct Part {
+        std::vector<GLuint> tris; // the index of the first vert of each triangle
+        shared<Mesh> hull;
+        float concavity = 0;
+        vec3 deepest;
+    };
+
+    const auto makePart = [&](std::vector<GLuint> partTris) {
+        Part part;
+        part.tris = std::move(partTris);
+
+        std::vector<vec3> points;
+        std::unordered_set<GLuint> used;
+        for (const auto t : part.tris) {
+            for (auto k = 0; k < 3; ++k) {
+                if (used.insert(tris[t + k]).second) points.push_back(verts[tris[t + k]]);
+            }
+        }
+
+        part.hull = build(points);
+        if (!part.hull) return part;
+
+        // how far inside the hull each point is; points on the hull are 0
+        const auto planes = hullPlanes(*part.hull);
+        for (const auto& p : points) {
+            auto depth = FLT_MAX;
+            for (const auto& plane : planes)
+                depth = minf(depth, plane.w - glm::dot(vec3(plane), p));
+            if (depth > part.concavity) {
+                part.concavity = depth;
+                part.deepest = p;
+            }
+        }
+        return part;
+    };
+
+    std::vector<GLuint> allTris;
+    for (GLuint t = 0, n = (GLuint)tris.size(); t < n; t += 3) allTris.push_back(t);
+
+    const auto maxConcavity = settings.maxConcavity * glm::length(Mesh::getPreciseDims(verts));
+    std::vector<Part> parts;
+    parts.push_back(makePart(std::move(allTris)));
+
+    const auto centroid = [&](GLuint t) { return (verts[tris[t]] + verts[tris[t + 1]] + verts[tris[t + 2]]) / 3.f; };
+    while (parts.size() < settings.maxHulls) {
+        const auto worst = std::max_element(begin(parts), end(parts), [](const Part& p, const Part& q) { return p.concavity < q.concavity; });
+        if (worst->concavity <= maxConcavity) break;
+
+        // splits along the part's longest axis, through its deepest point, falling back to the median if that leaves a side empty
+        vec3 lo(FLT_MAX), hi(-FLT_MAX);
+        for (const auto t : worst->tris) {
+            lo = glm::min(lo, centroid(t));
+            hi = glm::max(hi, centroid(t));
+        }
+        const auto extent = hi - lo;
+        const auto axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        auto split = worst->deepest[axis];
+        const auto countBelow = [&](float value) {
+            return std::count_if(begin(worst->tris), end(worst->tris), [&](GLuint t) { return centroid(t)[axis] < value; });
+        };
+        auto below = countBelow(split);
+        if (below == 0 || below == (ptrdiff_t)worst->tris.size()) {
+            std::vector<float> values;
+            for (const auto t : worst->tris) values.push_back(centroid(t)[axis]);
+            std::nth_element(begin(values), begin(values) + values.size() / 2, end(values));
+            split = values[values.size() / 2];
+            below = countBelow(split);
+        }
+        if (below == 0 || below == (ptrdiff_t)worst->tris.size()) {
+            worst->concavity = 0; // can't be split any further
+            continue;
+        }
+
+        std::vector<GLuint> left, right;
+        for (const auto t : worst->tris)
+            (centroid(t)[axis] < split ? left : right).push_back(t);
+        *worst = makePart(std::move(left));
+        parts.push_back(makePart(std::move(right)));
+    }
+
+    std::vector<Piece> pieces;
+    for (auto& part : parts) {
+        if (!part.hull) continue;
+
+        const auto& hullVerts = part.hull->data().verts;
+        vec3 lo = hullVerts[0], hi = hullVerts[0];
+        for (const auto& v : hullVerts) {
+            lo = glm::min(lo, v);
+            hi = glm::max(hi, v);
+        }
+        const auto center = (lo + hi) * 0.5f;
+        part.hull->translate(-center);
+        pieces.push_back({ part.hull, center });
+    }
+    return pieces;
+}
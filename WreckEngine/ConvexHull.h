@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "Mesh.h"
+
+/*
+----------------------------------------------------------------------
+- Builds reduced collision meshes from render meshes, meant to be run at load time
+- build() finds the convex hull of a set of points with quickhull
+  - Starting from a tetrahedron of extreme points, it repeatedly takes the point furthest outside the hull,
+    removes every face that point can see, and fills the hole with new faces fanning out from it
+  - Points within a small tolerance of a face count as on it, so duplicate and nearly coplanar points are dropped rather than creating slivers
+  - The result is a welded triangle mesh, wound counter-clockwise when viewed from outside
+  - Colliders merge the hull's coplanar triangles back into single faces, so a hull costs no more than the shape it describes
+- decompose() approximates a concave mesh with several convex hulls, as SAT and GJK only work on convex shapes
+  - The concavity of a piece is how deep its deepest vertex lies inside its hull
+  - The most concave piece is split in two along its longest axis, through its deepest vertex, until every piece is flat enough
+  - Triangles go to whichever side their centroid is on; nothing is cut, so pieces can overlap slightly along the split
+----------------------------------------------------------------------
+*/
+namespace ConvexHull {
+
+    // the hull of [points], or null if they're all (close to) coplanar
+    shared<Mesh> build(const std::vector<vec3>& points);
+    shared<Mesh> build(const Mesh& mesh);
+
+    struct DecompositionSettings {
+        float maxConcavity = 0.05f; // relative to the length of the mesh's diagonal
+        size_t maxHulls = 16;
+    };
+
+    // a convex piece of a decomposed mesh; the hull is centered on the origin, as colliders expect, and [center] is where it goes in the mesh
+    struct Piece {
+        shared<Mesh> hull;
+        vec3 center;
+    };
+
+    // splits [mesh] into convex pieces; pieces that end up flat are dropped, as they have no volume to collide with
+    std::vector<Piece> decompose(const Mesh& mesh, const DecompositionSettings& settings = {});
+}
@@ -1,8 +1,12 @@
 #include "DrawDebug.h"
 #include <iostream>
 
+bool DrawDebug::headless = false;
+
 DrawDebug::DrawDebug() {
 #if DEBUG
+    if (headless) return;
+
     auto vecShader  = loadProgram("Shaders/_debug/vecvertexShader.glsl", "Shaders/_debug/vecfragmentShader.glsl");
     auto meshShader = loadProgram("Shaders/_debug/meshvertexShader.glsl", "Shaders/_debug/meshfragmentShader.glsl");
     
@@ -177,6 +181,7 @@ void DrawDebug::drawBoxes() {
 
 void DrawDebug::drawDebugVector(vec3 start, vec3 end, vec3 color) {
 #if DEBUG
+    if (headless) return;
     if (++vecsAdded > MAX_VECTORS) { --vecsAdded; return; }
     auto& v = debugVectors.get();
     v.push_back({ { start, color }, { end, color } });
@@ -185,6 +190,7 @@ void DrawDebug::drawDebugVector(vec3 start, vec3 end, vec3 color) {
 
 void DrawDebug::drawDebugSphere(vec3 pos, float rad, vec3 color, float opacity) {
 #if DEBUG
+    if (headless) return;
     if (++spheresAdded > MAX_SPHERES) { --spheresAdded; return; }
     auto& s = debugSpheres.get();
     s.push_back({ { color, opacity }, pos, rad });
@@ -193,6 +199,7 @@ void DrawDebug::drawDebugSphere(vec3 pos, float rad, vec3 color, float opacity)
 
 void DrawDebug::drawDebugBox(vec3 pos, float w, float h, float d, vec3 color, float opacity) {
 #if DEBUG
+    if (headless) return;
     if (++boxesAdded > MAX_BOXES) { --boxesAdded; return; }
     auto& b = debugBoxes.get();
     b.push_back({ pos, { w, h, d }, { color, opacity } });
@@ -78,6 +78,8 @@ private:
 class DrawDebug {
 public:
     static DrawDebug& get();
+    // set this before anything draws to run without a GL context; get() won't create any GL resources, and every draw is dropped
+    static bool headless;
 
     void flush();
     void postUpdate();
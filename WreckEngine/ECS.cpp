@@ -0,0 +1,16 @@
+#include "ECS.h"
+
+std::atomic<uint32_t> ecs::detail::nextComponentId { 0 };
+
+ecs::entity ecs::Registry::create() { return entities.emplace_back(); }
+
+void ecs::Registry::destroy(const entity e) {
+    const auto record = entities.try_get(e);
+    if (!record) return;
+
+    for (uint32_t id = 0, n = (uint32_t)pools.size(); id < n; ++id) {
+        if (record->components & (uint64_t(1) << id))
+            pools[id]->remove(e);
+    }
+    entities.removeAtBack(e);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "smart_ptr.h"
+#include "slot_map.h"
+
+/*
+----------------------------------------------------------------------
+- Entity-component storage for objects too numerous or too simple to each be an Entity, e.g. particles and pickups
+  - An entity here is just a versioned handle from a slot_map; it has no allocation or vtable of its own
+  - Each component type is stored in its own pool, packed contiguously, with a sparse index from entity to slot
+  - Components are plain structs; behavior lives in systems, which are functions run over the pools each update
+- Pools are sparse sets: adding appends, and removing moves the last component into the hole
+  - So a pool's order changes as things are removed, and nothing should be added or removed while iterating over it
+  - Handles of destroyed entities stay invalid, even once their slot is reused, as the versions won't match
+- each<A, B...> walks the smallest of the pools involved and looks the rest up, so rare components stay cheap to query
+- Existing Entity subclasses are stored through EntityAdapter, which is how State keeps updating and drawing them
+- There can be at most MAX_COMPONENTS component types in the program
+----------------------------------------------------------------------
+*/
+class Entity;
+
+namespace ecs {
+    constexpr uint32_t MAX_COMPONENTS = 64;
+
+    namespace detail {
+        struct Record { uint64_t components = 0; };
+        extern std::atomic<uint32_t> nextComponentId;
+    }
+
+    using entity = slot_map<detail::Record>::key;
+
+    // tags for declaring which components a system reads and writes, see State::addSystem
+    template<class... Ts> struct reads {};
+    template<class... Ts> struct writes {};
+
+    // gives each component type its own index, the first time it's used
+    template<class T> uint32_t componentId() {
+        static const uint32_t id = detail::nextComponentId++;
+        assert(id < MAX_COMPONENTS);
+        return id;
+    }
+
+    // the untyped part of a pool, i.e. which entity owns which slot
+    class PoolBase {
+    public:
+        static constexpr uint32_t NONE = UINT32_MAX;
+        virtual ~PoolBase() = default;
+
+        size_t size() const { return owners.size(); }
+        entity owner(const size_t i) const { return owners[i]; }
+        bool contains(const entity e) const { return indexOf(e) != NONE; }
+        virtual void remove(entity e) = 0;
+
+    protected:
+        uint32_t indexOf(const entity e) const {
+            if (e.index >= sparse.size()) return NONE;
+            const auto i = sparse[e.index];
+            return i != NONE && owners[i].version == e.version ? i : NONE;
+        }
+
+        std::vector<uint32_t> sparse; // entity index -> slot
+        std::vector<entity> owners;   // slot -> entity
+    };
+
+    template<class T>
+    class Pool : public PoolBase {
+    public:
+        T* get(const entity e) {
+            const auto i = indexOf(e);
+            return i == NONE ? nullptr : &values[i];
+        }
+
+        // replaces the component if the entity already has one
+        template<class... Args>
+        T& add(const entity e, Args&&... args) {
+            if (auto existing = get(e)) return *existing = T { std::forward<Args>(args)... };
+            if (e.index >= sparse.size()) sparse.resize(e.index + 1, NONE);
+            sparse[e.index] = (uint32_t)values.size();
+            owners.push_back(e);
+            values.push_back(T { std::forward<Args>(args)... });
+            return values.back();
+        }
+
+        void remove(const entity e) override {
+            const auto i = indexOf(e);
+            if (i == NONE) return;
+
+            const auto last = values.size() - 1;
+            if (i != last) {
+                values[i] = std::move(values[last]);
+                owners[i] = owners[last];
+                sparse[owners[i].index] = i;
+            }
+            values.pop_back();
+            owners.pop_back();
+            sparse[e.index] = NONE;
+        }
+
+        T& operator[](const size_t i) { return values[i]; }
+        T* begin() { return values.data(); }
+        T* end()   { return values.data() + values.size(); }
+
+    private:
+        std::vector<T> values;
+    };
+
+    class Registry {
+    public:
+        entity create();
+        // removes all of the entity's components too
+        void destroy(entity e);
+        bool alive(const entity e) const { return entities.try_get(e) != nullptr; }
+        size_t size() const { return entities.size(); }
+
+        template<class T, class... Args>
+        T& add(const entity e, Args&&... args) {
+            entities[e].components |= bit<T>();
+            return pool<T>().add(e, std::forward<Args>(args)...);
+        }
+
+        template<class T>
+        void remove(const entity e) {
+            entities[e].components &= ~bit<T>();
+            pool<T>().remove(e);
+        }
+
+        template<class T> T* get(const entity e) { return pool<T>().get(e); }
+        template<class T> bool has(const entity e) const {
+            const auto record = entities.try_get(e);
+            return record && (record->components & bit<T>());
+        }
+
+        template<class T>
+        Pool<T>& pool() {
+            const auto id = componentId<T>();
+            if (id >= pools.size()) pools.resize(id + 1);
+            if (!pools[id]) pools[id] = make_unique<Pool<T>>();
+            return static_cast<Pool<T>&>(*pools[id]);
+        }
+
+        // calls [f](entity, A&, B&...) for every entity that has all of the components
+        template<class... Ts, class F>
+        void each(F&& f) {
+            if constexpr (sizeof...(Ts) == 1) {
+                auto& only = pool<Ts...>();
+                for (size_t i = 0, n = only.size(); i < n; ++i)
+                    f(only.owner(i), only[i]);
+            }
+            else {
+                PoolBase* smallest = nullptr;
+                ((smallest = !smallest || pool<Ts>().size() < smallest->size() ? &pool<Ts>() : smallest), ...);
+                for (size_t i = 0, n = smallest->size(); i < n; ++i) {
+                    const auto e = smallest->owner(i);
+                    const auto components = std::make_tuple(pool<Ts>().get(e)...);
+                    if ((std::get<Ts*>(components) && ...))
+                        f(e, *std::get<Ts*>(components)...);
+                }
+            }
+        }
+
+        // the components' bits, as kept for each entity
+        template<class... Ts> static uint64_t mask() { return (uint64_t(0) | ... | bit<Ts>()); }
+
+    private:
+        template<class T> static uint64_t bit() { return uint64_t(1) << componentId<T>(); }
+
+        slot_map<detail::Record> entities;
+        std::vector<unique<PoolBase>> pools; // indexed by component id
+    };
+
+    // lets an existing Entity live in a registry; State updates and draws these as it always has
+    struct EntityAdapter {
+        shared<Entity> entity;
+    };
+}
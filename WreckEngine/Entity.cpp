@@ -9,5 +9,9 @@ Entity::Entity(vec3 p, vec3 sc, vec3 rA, float r, shared<GraphicsWorker> s) : En
 }
 
 void Entity::draw() {
-    shape->draw(&transform, this);
+    if (!shape) return;
+    if (renderPose.published())
+        shape->draw(renderPose.world(Time::now()), this);
+    else
+        shape->draw(&transform, this);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include "Renderable.h"
 #include "Transform.h"
+#include "PoseBuffer.h"
 
 class Entity
 {
@@ -17,7 +18,12 @@ public:
     virtual ~Entity() = default;
 
     Transform transform;
+    // entities moved on another thread (e.g. by physics) publish their poses here, and are drawn from them instead of the transform
+    PoseBuffer renderPose;
     bool active = true;
+    // set if update and physicsUpdate only touch this entity's own state, so a parallel State can run them alongside other entities
+    // they'll be run on pool threads, so they have to go by the dt they're given rather than Time, and can't add or remove entities
+    bool isolated = false;
 
     void* id = (void*)Random::get(); // meant to identify the object for debugging purposes
 
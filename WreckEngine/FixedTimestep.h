@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+----------------------------------------------------------------------
+- Turns the variable frame times of a thread into a whole number of fixed steps, carrying the remainder over to the next frame
+  - A frame that took longer than a step runs several steps to catch up (sub-stepping)
+  - A frame that took less than a step may run none at all
+- The number of steps per frame is capped, and any time past the cap is dropped
+  - Otherwise a frame that overruns its budget has to run even more steps next frame, which overruns by even more (the spiral of death)
+  - The simulation slows down instead, until the load drops
+----------------------------------------------------------------------
+*/
+class FixedTimestep {
+public:
+    FixedTimestep(double step, size_t maxSteps) : _step(step), maxSteps(maxSteps) {}
+
+    // adds [delta] seconds to the accumulator, returning the number of steps to run
+    size_t advance(double delta) {
+        accumulator += delta;
+        auto steps = (size_t)(accumulator / _step);
+        if (steps > maxSteps) {
+            steps = maxSteps;
+            accumulator = 0;
+        }
+        else
+            accumulator -= steps * _step;
+        return steps;
+    }
+
+    double step() const { return _step; }
+
+private:
+    double _step, accumulator = 0;
+    size_t maxSteps;
+};
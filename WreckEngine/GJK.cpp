@@ -0,0 +1,331 @@
+#include "GJK.h"
+
+#include <algorithm>
+
+using namespace GJK;
+
+namespace {
+
+    Vertex support(Collider* a, Collider* b, const vec3 dir) {
+        const auto pa = a->getSupportPoint(dir).point, pb = b->getSupportPoint(-dir).point;
+        return { pa - pb, pa, pb };
+    }
+
+    inline bool sameDir(const vec3 v, const vec3 ao) { return glm::dot(v, ao) > 0; }
+
+    void set(Simplex& s, std::initializer_list<Vertex> verts) {
+        s.size = 0;
+        for (const auto& v : verts) s.verts[s.size++] = v;
+    }
+
+    /*
+    ----------------------------------------------------------------------
+    - Each case reduces the simplex to the feature closest to the origin and points the search direction at the origin from it
+    - The newest point is always first; it's the only one that can be closest, as the last search went past the others towards the origin
+    ----------------------------------------------------------------------
+    */
+    bool line(Simplex& s, vec3& dir) {
+        const auto a = s.verts[0], b = s.verts[1];
+        const auto ab = b.point - a.point, ao = -a.point;
+        if (sameDir(ab, ao)) {
+            dir = glm::cross(glm::cross(ab, ao), ab);
+            // the origin is on the segment, which happens whenever a sphere's support points line up with the centers;
+            // any direction perpendicular to it will do
+            if (epsCheck(glm::dot(dir, dir)))
+                dir = glm::cross(ab, std::abs(ab.x) < 0.577f ? vec3(1, 0, 0) : vec3(0, 1, 0));
+        }
+        else {
+            set(s, { a });
+            dir = ao;
+        }
+        return false;
+    }
+
+    bool triangle(Simplex& s, vec3& dir) {
+        const auto a = s.verts[0], b = s.verts[1], c = s.verts[2];
+        const auto ab = b.point - a.point, ac = c.point - a.point, ao = -a.point;
+        const auto abc = glm::cross(ab, ac);
+
+        if (sameDir(glm::cross(abc, ac), ao)) {
+            if (sameDir(ac, ao)) {
+                set(s, { a, c });
+                dir = glm::cross(glm::cross(ac, ao), ac);
+            }
+            else {
+                set(s, { a, b });
+                return line(s, dir);
+            }
+        }
+        else if (sameDir(glm::cross(ab, abc), ao)) {
+            set(s, { a, b });
+            return line(s, dir);
+        }
+        // the origin is above or below the triangle; the winding is kept so the normal faces the origin
+        else if (sameDir(abc, ao))
+            dir = abc;
+        else {
+            set(s, { a, c, b });
+            dir = -abc;
+        }
+        return false;
+    }
+
+    bool tetrahedron(Simplex& s, vec3& dir) {
+        const auto a = s.verts[0], b = s.verts[1], c = s.verts[2], d = s.verts[3];
+        const auto ab = b.point - a.point, ac = c.point - a.point, ad = d.point - a.point, ao = -a.point;
+
+        if (sameDir(glm::cross(ab, ac), ao)) { set(s, { a, b, c }); return triangle(s, dir); }
+        if (sameDir(glm::cross(ac, ad), ao)) { set(s, { a, c, d }); return triangle(s, dir); }
+        if (sameDir(glm::cross(ad, ab), ao)) { set(s, { a, d, b }); return triangle(s, dir); }
+        return true;
+    }
+
+    bool nextSimplex(Simplex& s, vec3& dir) {
+        switch (s.size) {
+        case 2:  return line(s, dir);
+        case 3:  return triangle(s, dir);
+        case 4:  return tetrahedron(s, dir);
+        default: return false;
+        }
+    }
+
+    // barycentric coordinates of p (assumed to be on the triangle's plane)
+    vec3 barycentric(const vec3 p, const vec3 a, const vec3 b, const vec3 c) {
+        const auto v0 = b - a, v1 = c - a, v2 = p - a;
+        const auto d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+        const auto d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+        const auto denom = d00 * d11 - d01 * d01;
+        if (epsCheck(denom)) return vec3(1, 0, 0);
+
+        const auto v = (d11 * d20 - d01 * d21) / denom, w = (d00 * d21 - d01 * d20) / denom;
+        return vec3(1 - v - w, v, w);
+    }
+
+    /*
+    ----------------------------------------------------------------------
+    - These find the point on the simplex closest to the origin, for the distance query
+    - The simplex is reduced to the smallest feature that point is on, which is all the next iteration needs
+    - Each case works through the Voronoi regions of the feature's vertices and edges before settling on its interior
+    ----------------------------------------------------------------------
+    */
+    vec3 closestLine(Simplex& s) {
+        const auto a = s.verts[0].point, ab = s.verts[1].point - a;
+        const auto t = -glm::dot(a, ab), len = glm::dot(ab, ab);
+        if (t <= 0) { set(s, { s.verts[0] }); return a; }
+        if (t >= len) { set(s, { s.verts[1] }); return a + ab; }
+        return a + ab * (t / len);
+    }
+
+    vec3 closestTriangle(Simplex& s) {
+        const auto va = s.verts[0], vb = s.verts[1], vc = s.verts[2];
+        const auto a = va.point, b = vb.point, c = vc.point;
+        const auto ab = b - a, ac = c - a;
+
+        const auto d1 = -glm::dot(ab, a), d2 = -glm::dot(ac, a);
+        if (d1 <= 0 && d2 <= 0) { set(s, { va }); return a; }
+
+        const auto d3 = -glm::dot(ab, b), d4 = -glm::dot(ac, b);
+        if (d3 >= 0 && d4 <= d3) { set(s, { vb }); return b; }
+
+        const auto edgeC = d1 * d4 - d3 * d2;
+        if (edgeC <= 0 && d1 >= 0 && d3 <= 0) { set(s, { va, vb }); return a + ab * (d1 / (d1 - d3)); }
+
+        const auto d5 = -glm::dot(ab, c), d6 = -glm::dot(ac, c);
+        if (d6 >= 0 && d5 <= d6) { set(s, { vc }); return c; }
+
+        const auto edgeB = d5 * d2 - d1 * d6;
+        if (edgeB <= 0 && d2 >= 0 && d6 <= 0) { set(s, { va, vc }); return a + ac * (d2 / (d2 - d6)); }
+
+        const auto edgeA = d3 * d6 - d5 * d4;
+        if (edgeA <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+            set(s, { vb, vc });
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        const auto denom = edgeA + edgeB + edgeC;
+        if (epsCheck(denom)) return closestLine(s); // a degenerate triangle; its longest edge is as good as any
+        return a + ab * (edgeB / denom) + ac * (edgeC / denom);
+    }
+
+    // returns false if the origin is inside the tetrahedron
+    bool closestTetrahedron(Simplex& s, vec3& closest) {
+        constexpr size_t faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } }; // each face, then the vert opposite it
+
+        auto inside = true;
+        auto bestDist = FLT_MAX;
+        Simplex best;
+        for (const auto& f : faces) {
+            const auto a = s.verts[f[0]].point;
+            const auto normal = glm::cross(s.verts[f[1]].point - a, s.verts[f[2]].point - a);
+            const auto opposite = glm::dot(normal, s.verts[f[3]].point - a);
+            // a flat tetrahedron can't contain anything, so every face counts as facing the origin
+            if (!epsCheck(opposite) && glm::dot(normal, -a) * opposite >= 0) continue;
+            inside = false;
+
+            Simplex face;
+            set(face, { s.verts[f[0]], s.verts[f[1]], s.verts[f[2]] });
+            const auto point = closestTriangle(face);
+            const auto dist = glm::dot(point, point);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = face;
+                closest = point;
+            }
+        }
+
+        if (!inside) s = best;
+        return !inside;
+    }
+}
+
+bool GJK::intersects(Collider* a, Collider* b, Simplex& simplex) {
+    auto dir = a->framePos() - b->framePos();
+    if (epsCheck(glm::dot(dir, dir))) dir = vec3(1, 0, 0);
+
+    simplex.verts[0] = support(a, b, dir);
+    simplex.size = 1;
+    dir = -simplex.verts[0].point;
+
+    for (size_t i = 0; i < MAX_ITERATIONS; ++i) {
+        // the origin is on the simplex, so the colliders are only just touching; there's nothing for EPA to expand
+        if (epsCheck(glm::dot(dir, dir))) return false;
+
+        const auto v = support(a, b, dir);
+        // the furthest point towards the origin doesn't reach it, so it's outside the Minkowski difference
+        if (glm::dot(v.point, dir) < 0) return false;
+
+        std::copy_backward(simplex.verts, simplex.verts + simplex.size, simplex.verts + simplex.size + 1);
+        simplex.verts[0] = v;
+        ++simplex.size;
+
+        if (nextSimplex(simplex, dir)) return true;
+    }
+    return false;
+}
+
+// the same search as intersects, but always heading for the point closest to the origin, so it can tell how far apart the colliders are
+float GJK::distance(Collider* a, Collider* b, vec3& closest) {
+    auto dir = a->framePos() - b->framePos();
+    if (epsCheck(glm::dot(dir, dir))) dir = vec3(1, 0, 0);
+
+    Simplex simplex;
+    simplex.verts[0] = support(a, b, dir);
+    simplex.size = 1;
+    closest = simplex.verts[0].point;
+
+    for (size_t i = 0; i < MAX_ITERATIONS; ++i) {
+        const auto distSq = glm::dot(closest, closest);
+        if (distSq < DISTANCE_TOLERANCE * DISTANCE_TOLERANCE) return 0;
+
+        // nothing gets any closer to the origin than the current point does, so it's the closest
+        const auto v = support(a, b, -closest);
+        if (distSq - glm::dot(v.point, closest) <= DISTANCE_TOLERANCE * sqrtf(distSq)) break;
+
+        std::copy_backward(simplex.verts, simplex.verts + simplex.size, simplex.verts + simplex.size + 1);
+        simplex.verts[0] = v;
+        ++simplex.size;
+
+        auto next = closest;
+        switch (simplex.size) {
+        case 2: next = closestLine(simplex); break;
+        case 3: next = closestTriangle(simplex); break;
+        case 4: if (!closestTetrahedron(simplex, next)) return 0; break;
+        }
+
+        // rounding can keep it from getting any closer once it's right on top of the answer
+        if (glm::dot(next, next) >= distSq) break;
+        closest = next;
+    }
+    return glm::length(closest);
+}
+
+Manifold GJK::penetration(Collider* a, Collider* b, const Simplex& simplex) {
+    struct Face { size_t v[3]; vec3 normal; float dist; };
+    struct HorizonEdge { size_t from, to; };
+
+    // every iteration adds one vert, and two more faces than it removes while the polytope stays convex, so these shouldn't ever spill
+    small_vector<Vertex, 4 + MAX_ITERATIONS> verts;
+    small_vector<Face, 4 + 2 * MAX_ITERATIONS> faces;
+    small_vector<HorizonEdge, 32> horizon;
+    verts.insert(simplex.verts, simplex.verts + simplex.size);
+
+    // the origin can be on the boundary of the starting tetrahedron (e.g. when a sphere's support points line up with the centers),
+    // so faces are oriented against its centroid instead, which is always strictly inside the polytope
+    const auto interior = (verts[0].point + verts[1].point + verts[2].point + verts[3].point) * 0.25f;
+
+    // adds a face wound so its normal points out of the polytope
+    const auto addFace = [&](size_t i0, size_t i1, size_t i2) {
+        auto normal = glm::cross(verts[i1].point - verts[i0].point, verts[i2].point - verts[i0].point);
+        const auto len = glm::length(normal);
+        if (epsCheck(len)) return;
+        normal /= len;
+
+        if (glm::dot(normal, verts[i0].point - interior) < 0) {
+            std::swap(i1, i2);
+            normal = -normal;
+        }
+        faces.push_back({ { i0, i1, i2 }, normal, maxf(glm::dot(normal, verts[i0].point), 0) });
+    };
+
+    addFace(0, 1, 2);
+    addFace(0, 3, 1);
+    addFace(0, 2, 3);
+    addFace(1, 3, 2);
+
+    size_t closest = 0;
+    for (size_t i = 0; i < MAX_ITERATIONS && faces.size(); ++i) {
+        closest = 0;
+        for (size_t f = 1, numFaces = faces.size(); f < numFaces; ++f) {
+            if (faces[f].dist < faces[closest].dist) closest = f;
+        }
+
+        const auto normal = faces[closest].normal;
+        const auto v = support(a, b, normal);
+        // the polytope can't be expanded any further towards this face, so it's on the boundary of the Minkowski difference
+        if (glm::dot(v.point, normal) - faces[closest].dist < EPA_TOLERANCE) break;
+
+        // remove every face the new point can see, keeping the edges that border the remaining faces
+        horizon.clear();
+        for (size_t f = faces.size(); f-- > 0;) {
+            if (glm::dot(faces[f].normal, v.point - verts[faces[f].v[0]].point) <= 0) continue;
+
+            for (auto e = 0; e < 3; ++e) {
+                const HorizonEdge edge{ faces[f].v[e], faces[f].v[(e + 1) % 3] };
+                // an edge shared by two removed faces is interior, and shows up once in each direction
+                const auto shared = std::find_if(horizon.begin(), horizon.end(), [&](const HorizonEdge& h) { return h.from == edge.to && h.to == edge.from; });
+                if (shared != horizon.end())
+                    horizon.erase(shared);
+                else
+                    horizon.push_back(edge);
+            }
+            faces[f] = faces.back();
+            faces.pop_back();
+        }
+
+        verts.push_back(v);
+        for (const auto& edge : horizon)
+            addFace(edge.from, edge.to, verts.size() - 1);
+        closest = 0;
+    }
+
+    Manifold m;
+    if (faces.empty()) return m;
+
+    for (size_t f = 1, numFaces = faces.size(); f < numFaces; ++f) {
+        if (faces[f].dist < faces[closest].dist) closest = f;
+    }
+    const auto& face = faces[closest];
+
+    // the point on the face closest to the origin maps back to a point on each collider, and the contact is between them
+    const auto& v0 = verts[face.v[0]], & v1 = verts[face.v[1]], & v2 = verts[face.v[2]];
+    const auto coords = barycentric(face.normal * face.dist, v0.point, v1.point, v2.point);
+    const auto onA = coords.x * v0.a + coords.y * v1.a + coords.z * v2.a;
+    const auto onB = coords.x * v0.b + coords.y * v1.b + coords.z * v2.b;
+
+    m.originator = a;
+    m.other = b;
+    m.axis = face.normal;
+    m.pen = -face.dist;
+    m.colPoints.push_back((onA + onB) * 0.5f);
+    return m;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Collider.h"
+
+/*
+----------------------------------------------------------------------
+- GJK and EPA work entirely through support points on the Minkowski difference of two colliders (A - B)
+  - The colliders overlap if and only if the Minkowski difference contains the origin
+- GJK builds simplices (up to a tetrahedron) out of support points, always moving towards the origin,
+  until it either encloses the origin or finds a support point that can't reach past it
+- EPA then expands the enclosing tetrahedron into a polytope, adding the support point beyond the face closest to the origin
+  until no support point gets any further; that face gives the penetration axis and depth
+- Each iteration only costs a support query on each collider, which hill climbing makes very cheap for big meshes,
+  whereas SAT has to test every face and edge pair
+- The downside is that EPA only gives a single contact point, so SAT is still preferred for meshes with resting contacts
+- The same search also gives the distance between colliders that don't overlap, by closing in on the point nearest the origin instead
+----------------------------------------------------------------------
+*/
+namespace GJK {
+
+    // a point on the Minkowski difference, along with the points on each collider it came from
+    struct Vertex { vec3 point, a, b; };
+
+    struct Simplex {
+        Vertex verts[4];
+        size_t size = 0;
+    };
+
+    constexpr size_t MAX_ITERATIONS = 64;
+    constexpr float EPA_TOLERANCE = 0.0001f;
+    constexpr float DISTANCE_TOLERANCE = 0.0001f;
+
+    // returns true if the colliders overlap, leaving a tetrahedron enclosing the origin in [simplex]
+    bool intersects(Collider* a, Collider* b, Simplex& simplex);
+    // finds the penetration axis (from a to b), depth, and contact point from GJK's enclosing tetrahedron
+    Manifold penetration(Collider* a, Collider* b, const Simplex& simplex);
+    // returns how far apart the colliders are, or 0 if they touch, leaving the point on their Minkowski difference nearest the origin in [closest];
+    // that's the offset across the gap from b to a, so a closes it by moving against it
+    float distance(Collider* a, Collider* b, vec3& closest);
+}
@@ -2,4 +2,8 @@
 
 void GraphicsWorker::draw(Transform* t, Entity* entity) {
     material.apply();
+}
+
+void GraphicsWorker::draw(const mat4& world, Entity* entity) {
+    material.apply();
 }
\ No newline at end of file
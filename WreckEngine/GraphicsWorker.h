@@ -10,4 +10,5 @@ public:
     // updates/binds material data at draw-time; intended for dispatch
     // pass an Entity pointer if applicable, otherwise nullptr
     virtual void draw(Transform* t, Entity* entity);
+    virtual void draw(const mat4& world, Entity* entity);
 };
\ No newline at end of file
@@ -126,6 +126,25 @@ quat quat::slerp(const quat& a, const quat& b, float t) { return quat::pow(b * q
 quat quat::rotation(float theta, vec3 axis) { return quat(axis, theta); }
 quat quat::point(float x, float y, float z) { return quat(x, y, z, 0); }
 
+mat3 quat::toMat3(const quat& q) {
+    // scaling by 2/|q|^2 keeps it a pure rotation even if q has drifted from unit length
+    const auto s = 2.f / glm::dot(q.vals, q.vals);
+    const auto xx = q.x * q.x * s, yy = q.y * q.y * s, zz = q.z * q.z * s;
+    const auto xy = q.x * q.y * s, xz = q.x * q.z * s, yz = q.y * q.z * s;
+    const auto wx = q.w * q.x * s, wy = q.w * q.y * s, wz = q.w * q.z * s;
+    return mat3(1 - (yy + zz), xy + wz, xz - wy
+              , xy - wz, 1 - (xx + zz), yz + wx
+              , xz + wy, yz - wx, 1 - (xx + yy));
+}
+
+mat4 composeTRS(const vec3& t, const quat& r, const vec3& s) {
+    const auto rot = quat::toMat3(r);
+    return mat4(vec4(rot[0] * s.x, 0)
+              , vec4(rot[1] * s.y, 0)
+              , vec4(rot[2] * s.z, 0)
+              , vec4(t, 1));
+}
+
 vec3 quat::getEuler(const quat& q) {
     vec3 euler;
     auto sqr = q.v * q.v;
@@ -5,6 +5,7 @@
 
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include "Random.h"
 
@@ -36,6 +37,16 @@ typedef glm::mat3 mat3;
 typedef glm::mat4 mat4;
 class quat;
 
+// vec3s split into separate arrays for each component, so they can be processed several at a time with SIMD
+struct vec3_soa {
+    std::vector<float> x, y, z;
+    size_t size() const { return x.size(); }
+    vec3 operator[](const size_t i) const { return vec3(x[i], y[i], z[i]); }
+    void set(const size_t i, const vec3 v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+    void push_back(const vec3 v) { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+    void pop_back() { x.pop_back(); y.pop_back(); z.pop_back(); }
+};
+
 bool fuzzyParallel(vec3 a, vec3 b);
 bool fuzzyParallelUnit(vec3 a, vec3 b);
 
@@ -86,6 +97,9 @@ public:
     static float getEulerY(const quat& q);
     static float getEulerZ(const quat& q);
 
+    // the rotation as a matrix, built straight from the components rather than through the angle and axis
+    static mat3 toMat3(const quat& q);
+
 private:
     float _theta = 0, sin_t_half = 0;
     vec3 _axis { 0, 0, 1 };
@@ -101,6 +115,9 @@ inline quat operator*(float f, const quat& q) { return q * f; }
 quat operator/(const quat& q, float f);
 quat operator*(const quat& a, const quat& b);
 
+// the same as translate * rotate * scale, but without building or multiplying the separate matrices
+mat4 composeTRS(const vec3& t, const quat& r, const vec3& s);
+
 template<typename T> inline std::string to_string(const T& obj) { return std::to_string(obj); }
 template<> inline std::string to_string<vec2>(const vec2& v) { return to_string(v.x) + "," + to_string(v.y); };
 std::string to_string(const vec2&, size_t precision);
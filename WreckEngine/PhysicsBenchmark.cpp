@@ -0,0 +1,322 @@
+#include "PhysicsBenchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "thread_pool.h"
+
+#include "CollisionManager.h"
+#include "ConvexHull.h"
+#include "DrawDebug.h"
+#include "PhysicsReplay.h"
+#include "RigidBody.h"
+#include "Time.h"
+
+// define this (e.g. in the project's preprocessor definitions) for a build that counts allocations during benchmarks
+//#define PHYSICS_BENCHMARK_ALLOCS
+
+namespace {
+    std::atomic<bool> countAllocs { false };
+    std::atomic<size_t> numAllocs { 0 };
+}
+
+#ifdef PHYSICS_BENCHMARK_ALLOCS
+// replaces the global allocator for the whole executable, which is why it's kept out of normal builds;
+// outside of benchmarks it's just malloc behind a relaxed load
+void* operator new(size_t size) {
+    if (countAllocs.load(std::memory_order_relaxed)) numAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+#endif
+
+namespace {
+    using rng_t = std::mt19937; // not Random, as that's seeded from the clock
+
+    struct World {
+        rng_t rng { 0x5eed };
+        std::vector<shared<ColliderEntity>> entities;
+        std::vector<shared<Mesh>> rocks;
+
+        // boxes and spheres use their own colliders, so they're tested with their own routines; only rocks are meshes
+        enum class Shape { BOX, SPHERE, ROCK };
+
+        float range(float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); }
+        // the braces make the components get drawn in order
+        vec3 direction() { return glm::normalize(vec3 { range(-1, 1), range(-1, 1), range(-1, 1) } + vec3(FLT_EPSILON)); }
+
+        // the shapes are all unit sized and centered on the origin, like the meshes in Assets
+        ColliderEntity* add(const Shape shape, const vec3 pos) {
+            switch (shape) {
+            case Shape::BOX:    entities.push_back(make_shared<ColliderEntity>(vec3(0.5f))); break;
+            case Shape::SPHERE: entities.push_back(make_shared<ColliderEntity>(0.5f));       break;
+            case Shape::ROCK:   entities.push_back(make_shared<ColliderEntity>(rock()));     break;
+            }
+            auto e = entities.back().get();
+            e->transform.position = pos;
+            e->collider()->update();
+            return e;
+        }
+
+        // spins the body to a random orientation
+        ColliderEntity* addTumbling(const Shape shape, const vec3 pos) {
+            auto e = add(shape, pos);
+            const auto angle = range(0, 2 * PI); // drawn separately, as argument order isn't fixed
+            e->transform.rotate(angle, direction());
+            e->collider()->update();
+            return e;
+        }
+
+        void addGround(const float size) {
+            auto ground = add(Shape::BOX, vec3(0, -0.5f, 0));
+            ground->transform.scale = vec3(size, 1, size);
+            ground->rigidBody.mass(0);
+            ground->collider()->update();
+        }
+
+        shared<Mesh> rock() { return rocks[std::uniform_int_distribution<size_t>(0, rocks.size() - 1)(rng)]; }
+    };
+
+    // an irregular convex lump, made from points scattered over a sphere at different depths
+    shared<Mesh> genRock(World& world) {
+        std::vector<vec3> points;
+        for (auto i = 0; i < 24; ++i) {
+            const auto dir = world.direction();
+            points.push_back(dir * world.range(0.35f, 0.5f));
+        }
+        return ConvexHull::build(points);
+    }
+
+    // square pyramids of boxes, resting on each other exactly
+    void buildPyramids(World& world) {
+        constexpr size_t PYRAMIDS = 4, BASE = 16;
+        constexpr float SPACING = 24;
+        world.addGround(128);
+        for (size_t p = 0; p < PYRAMIDS; ++p) {
+            const auto corner = vec3((p % 2) * SPACING - SPACING * 0.5f, 0, (p / 2) * SPACING - SPACING * 0.5f);
+            for (size_t layer = 0; layer < BASE; ++layer) {
+                const auto width = BASE - layer;
+                for (size_t x = 0; x < width; ++x)
+                    for (size_t z = 0; z < width; ++z)
+                        world.add(World::Shape::BOX, corner + vec3(x + layer * 0.5f, layer + 0.5f, z + layer * 0.5f));
+            }
+        }
+    }
+
+    // spheres dropped in loose layers, which bounce off each other and spread out over the ground
+    void buildSphereRain(World& world) {
+        constexpr size_t WIDTH = 20, LAYERS = 5;
+        constexpr float SPACING = 1.5f;
+        world.addGround(128);
+        for (size_t layer = 0; layer < LAYERS; ++layer)
+            for (size_t x = 0; x < WIDTH; ++x)
+                for (size_t z = 0; z < WIDTH; ++z) {
+                    const auto jitterX = world.range(-0.2f, 0.2f), jitterZ = world.range(-0.2f, 0.2f);
+                    const auto jitter = vec3(jitterX, 0, jitterZ);
+                    world.add(World::Shape::SPHERE, vec3((x - WIDTH * 0.5f) * SPACING, 10 + layer * SPACING, (z - WIDTH * 0.5f) * SPACING) + jitter);
+                }
+    }
+
+    // rocks dropped tightly packed, so they land on each other and pile up
+    void buildMeshPile(World& world) {
+        constexpr size_t WIDTH = 10, LAYERS = 10;
+        constexpr float SPACING = 1.1f;
+        world.addGround(64);
+        for (size_t layer = 0; layer < LAYERS; ++layer)
+            for (size_t x = 0; x < WIDTH; ++x)
+                for (size_t z = 0; z < WIDTH; ++z)
+                    world.addTumbling(World::Shape::ROCK, vec3((x - WIDTH * 0.5f) * SPACING, 1 + layer * SPACING, (z - WIDTH * 0.5f) * SPACING));
+    }
+
+    // 10k bodies of every kind, dropped in a block
+    void buildMixed(World& world) {
+        constexpr size_t WIDTH = 25, LAYERS = 16;
+        constexpr float SPACING = 1.5f;
+        world.addGround(256);
+        size_t i = 0;
+        for (size_t layer = 0; layer < LAYERS; ++layer)
+            for (size_t x = 0; x < WIDTH; ++x)
+                for (size_t z = 0; z < WIDTH; ++z, ++i) {
+                    const auto shape = i % 3 == 0 ? World::Shape::BOX : i % 3 == 1 ? World::Shape::SPHERE : World::Shape::ROCK;
+                    world.addTumbling(shape, vec3((x - WIDTH * 0.5f) * SPACING, 1 + layer * SPACING, (z - WIDTH * 0.5f) * SPACING));
+                }
+    }
+
+    struct Scene {
+        const char* name;
+        void (*build)(World&);
+    };
+
+    const Scene scenes[] = {
+        { "pyramids", &buildPyramids },
+        { "spheres",  &buildSphereRain },
+        { "meshes",   &buildMeshPile },
+        { "mixed",    &buildMixed },
+    };
+
+    struct Timing {
+        double total = 0, worst = 0;
+        void add(const double ms) { total += ms; worst = std::max(worst, ms); }
+    };
+
+    inline double msSince(const Time::time_point start) { return Time::get_duration(start, Time::now()) * 1000; }
+
+    const Scene* findScene(const char* name) {
+        for (const auto& scene : scenes) {
+            if (std::strcmp(name, scene.name) == 0) return &scene;
+        }
+
+        printf("Error! There's no benchmark scene called %s; the scenes are:", name);
+        for (const auto& scene : scenes) printf(" %s", scene.name);
+        printf("\n");
+        return nullptr;
+    }
+
+    enum class Replay { NONE, RECORD, PLAYBACK };
+
+    // returns false if the replay couldn't be started, or the playback diverged from the recording
+    bool runScene(const Scene& scene, size_t ticks, const Replay mode = Replay::NONE, const char* path = nullptr) {
+        World world;
+        for (auto i = 0; i < 8; ++i) world.rocks.push_back(genRock(world));
+
+        scene.build(world);
+        const auto numBodies = world.entities.size();
+
+        // playbacks run for as long as the recording does
+        auto& replay = PhysicsReplay::get();
+        auto started = true;
+        if (mode == Replay::RECORD)
+            started = replay.startRecording(path, PhysicsBenchmark::STEP);
+        else if (mode == Replay::PLAYBACK) {
+            started = replay.startPlayback(path);
+            if (started && replay.step() != PhysicsBenchmark::STEP) {
+                printf("Error! %s was recorded with a step of %.4fs, but the benchmark steps by %.4fs.\n", path, replay.step(), PhysicsBenchmark::STEP);
+                replay.stop();
+                started = false;
+            }
+            ticks = SIZE_MAX;
+        }
+        if (!started) {
+            CollisionManager::getInstance().clear();
+            return false;
+        }
+
+        auto& bodies = RigidBodyWorld::get();
+        auto& collisions = CollisionManager::getInstance();
+        const auto step = (float)PhysicsBenchmark::STEP;
+
+        Timing integrate, broad, continuous, narrow, solve, query, total;
+        size_t pairs = 0, tested = 0, contacts = 0, islands = 0;
+        numAllocs = 0;
+        countAllocs = true;
+        size_t tick = 0;
+        std::unique_lock<std::recursive_mutex> ticking(bodies.tickMutex);
+        for (; tick < ticks && replay.beginTick(); ++tick) {
+            Time::update();
+            const auto start = Time::now();
+            bodies.update(step);
+            integrate.add(msSince(start));
+            collisions.update(step);
+            total.add(msSince(start));
+            replay.endTick();
+
+            const auto& stats = collisions.stats();
+            broad.add(stats.broad);
+            continuous.add(stats.continuous);
+            narrow.add(stats.narrow);
+            solve.add(stats.solve);
+            query.add(stats.query);
+            pairs += stats.pairs;
+            tested += stats.tested;
+            contacts += stats.contacts;
+            islands += stats.islands;
+        }
+        countAllocs = false;
+        ticking.unlock();
+        const auto diverged = replay.divergedTick();
+        replay.stop();
+
+        collisions.clear();
+        world.entities.clear();
+
+        ticks = tick;
+        const auto n = (double)std::max<size_t>(ticks, 1);
+        printf("%s: %zu bodies, %zu ticks\n", scene.name, numBodies, ticks);
+        printf("  %-12s %10s %10s\n", "phase", "avg ms", "worst ms");
+        const std::pair<const char*, const Timing*> phases[] = {
+            { "integrate", &integrate }, { "broad", &broad }, { "continuous", &continuous },
+            { "narrow", &narrow }, { "solve", &solve }, { "query", &query }, { "total", &total }
+        };
+        for (const auto& [name, timing] : phases)
+            printf("  %-12s %10.3f %10.3f\n", name, timing->total / n, timing->worst);
+        printf("  per tick: %.1f pairs, %.1f tested, %.1f contacts, %.1f islands", pairs / n, tested / n, contacts / n, islands / n);
+#ifdef PHYSICS_BENCHMARK_ALLOCS
+        printf(", %.1f allocations", numAllocs.load() / n);
+#endif
+        printf("\n\n");
+
+        if (mode == Replay::RECORD)
+            printf("recorded %zu ticks to %s\n", ticks, path);
+        else if (mode == Replay::PLAYBACK) {
+            if (diverged == SIZE_MAX)
+                printf("every one of the %zu ticks matched the recording\n", ticks);
+            else
+                printf("the playback diverged from the recording at tick %zu\n", diverged);
+        }
+        return diverged == SIZE_MAX;
+    }
+
+    void setup() {
+        DrawDebug::headless = true;
+        CollisionManager::getInstance().logContacts = false;
+    }
+}
+
+int PhysicsBenchmark::run(int argc, char** argv) {
+    auto ticks = DEFAULT_TICKS;
+    if (argc > 0) ticks = std::strtoul(argv[0], nullptr, 10);
+    const auto only = argc > 1 ? findScene(argv[1]) : nullptr;
+    if (argc > 1 && !only) return 1;
+
+    setup();
+    printf("physics benchmark: %zu ticks of %.4fs, %zu threads\n\n", ticks, STEP, thread_pool::get().size());
+
+    for (const auto& scene : scenes) {
+        if (only && only != &scene) continue;
+        runScene(scene, ticks);
+    }
+    return 0;
+}
+
+int PhysicsBenchmark::record(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Error! Recording needs a file and a scene: --physics-record <file> <scene> [ticks]\n");
+        return 1;
+    }
+    const auto scene = findScene(argv[1]);
+    if (!scene) return 1;
+    const auto ticks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : DEFAULT_TICKS;
+
+    setup();
+    return runScene(*scene, ticks, Replay::RECORD, argv[0]) ? 0 : 1;
+}
+
+int PhysicsBenchmark::replay(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Error! Replaying needs a file and the scene it was recorded from: --physics-replay <file> <scene>\n");
+        return 1;
+    }
+    const auto scene = findScene(argv[1]);
+    if (!scene) return 1;
+
+    setup();
+    return runScene(*scene, 0, Replay::PLAYBACK, argv[0]) ? 0 : 1;
+}
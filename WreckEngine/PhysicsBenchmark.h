@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+----------------------------------------------------------------------
+- Runs the physics stack headless over a set of standard scenes, and reports how long each phase took
+  - Run with: WreckEngine --physics-benchmark [ticks] [scene]
+  - With no scene given, every scene is run, one after the other, each from a fresh world
+- The scenes are built through ColliderEntity and CollisionManager, the same as a game would
+  - Boxes and spheres use box and sphere colliders, so they go through their own routines rather than the mesh ones
+  - The rest are convex hulls, generated rather than loaded, so nothing but the executable is needed
+  - Every random choice comes from a fixed seed, so each run simulates exactly the same thing
+- Each tick runs the rigid body integration and then the collision manager update, as the game's physics tick does
+  - Times are the average and worst per tick, in milliseconds; counts are averages per tick
+  - Allocations count every call to the global operator new on any thread during the ticks, whatever the size
+    - That means replacing the global operator new, so they're only counted in builds with PHYSICS_BENCHMARK_ALLOCS defined
+- Nothing touches GL, and debug drawing and contact logging are switched off, as they would swamp the physics itself
+- A scene can also be recorded and played back through PhysicsReplay, to check that physics changes didn't change the results
+  - Record with: WreckEngine --physics-record <file> <scene> [ticks]
+  - Replay with: WreckEngine --physics-replay <file> <scene>, which fails if any tick doesn't end exactly as it was recorded
+  - Only these scenes can be replayed headless; recordings made in the game need the game's scene, and so the game, to replay
+----------------------------------------------------------------------
+*/
+namespace PhysicsBenchmark {
+    constexpr size_t DEFAULT_TICKS = 600;
+    constexpr double STEP = 1.0 / 120;
+
+    // [argc] and [argv] are the arguments after --physics-benchmark; returns the exit code
+    int run(int argc, char** argv);
+    // the same, for the arguments after --physics-record and --physics-replay
+    int record(int argc, char** argv);
+    int replay(int argc, char** argv);
+}
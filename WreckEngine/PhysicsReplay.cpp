@@ -0,0 +1,167 @@
+#include "PhysicsReplay.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "CollisionManager.h"
+
+namespace {
+    template<typename T> inline void write(std::ofstream& out, const T& value) { out.write((const char*)&value, sizeof(T)); }
+    template<typename T> inline bool read(std::ifstream& in, T& value) { return (bool)in.read((char*)&value, sizeof(T)); }
+}
+
+bool PhysicsReplay::startRecording(const std::string& path, double step) {
+    stop();
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        printf("Error! Physics recording %s could not be opened.\n", path.c_str());
+        return false;
+    }
+
+    auto& world = RigidBodyWorld::get();
+    world.flush();
+    captureStates();
+    const auto numBodies = (uint32_t)states.size();
+    write(out, MAGIC);
+    write(out, VERSION);
+    write(out, step);
+    write(out, numBodies);
+    out.write((const char*)states.data(), numBodies * sizeof(RigidBodyWorld::BodyState));
+
+    // puts every body exactly where it is, the same as a playback would
+    for (uint32_t i = 0; i < numBodies; ++i)
+        world.state(i, states[i]);
+    CollisionManager::getInstance().resetCaches();
+
+    mode = Mode::RECORD;
+    _step = step;
+    _tick = 0;
+    _divergedTick = SIZE_MAX;
+    return true;
+}
+
+bool PhysicsReplay::startPlayback(const std::string& path) {
+    stop();
+    in.open(path, std::ios::binary);
+    if (!in.is_open()) {
+        printf("Error! Physics recording %s could not be opened.\n", path.c_str());
+        return false;
+    }
+
+    auto& world = RigidBodyWorld::get();
+    world.flush();
+    uint32_t magic = 0, version = 0, numBodies = 0;
+    if (!read(in, magic) || !read(in, version) || !read(in, _step) || !read(in, numBodies) || magic != MAGIC || version != VERSION) {
+        printf("Error! %s isn't a physics recording this version can play.\n", path.c_str());
+        stop();
+        return false;
+    }
+    if (numBodies != world.size()) {
+        printf("Error! %s was recorded with %u bodies, but the scene has %zu.\n", path.c_str(), numBodies, world.size());
+        stop();
+        return false;
+    }
+
+    states.resize(numBodies);
+    if (!in.read((char*)states.data(), numBodies * sizeof(RigidBodyWorld::BodyState))) {
+        printf("Error! %s ends before its first tick.\n", path.c_str());
+        stop();
+        return false;
+    }
+    for (uint32_t i = 0; i < numBodies; ++i)
+        world.state(i, states[i]);
+    CollisionManager::getInstance().resetCaches();
+
+    mode = Mode::PLAYBACK;
+    _tick = 0;
+    _divergedTick = SIZE_MAX;
+    return true;
+}
+
+void PhysicsReplay::stop() {
+    if (out.is_open()) out.close();
+    if (in.is_open()) in.close();
+    in.clear();
+    mode = Mode::IDLE;
+}
+
+bool PhysicsReplay::beginTick() {
+    auto& world = RigidBodyWorld::get();
+    world.flush();
+
+    switch (mode) {
+    case Mode::IDLE:
+        break;
+    case Mode::RECORD: {
+        const auto numBodies = world.size();
+        if (numBodies != states.size()) {
+            printf("Bodies were added or removed, so the physics recording was stopped after %zu ticks.\n", _tick);
+            stop();
+            break;
+        }
+
+        changes.clear();
+        for (size_t i = 0; i < numBodies; ++i) {
+            const auto state = world.state(i);
+            if (std::memcmp(&state, &states[i], sizeof(state)) != 0)
+                changes.push_back({ (uint32_t)i, state });
+        }
+        write(out, (uint32_t)changes.size());
+        out.write((const char*)changes.data(), changes.size() * sizeof(Change));
+        break;
+    }
+    case Mode::PLAYBACK: {
+        uint32_t numChanges = 0;
+        if (!read(in, numChanges)) {
+            stop();
+            return false;
+        }
+
+        changes.resize(numChanges);
+        if (!in.read((char*)changes.data(), numChanges * sizeof(Change))) {
+            printf("The physics recording ends partway through tick %zu.\n", _tick);
+            stop();
+            return false;
+        }
+        for (const auto& change : changes)
+            world.state(change.index, change.state);
+        break;
+    }
+    }
+    return true;
+}
+
+void PhysicsReplay::endTick() {
+    if (mode == Mode::IDLE) return;
+
+    captureStates();
+    const auto stateHash = hash(states);
+    if (mode == Mode::RECORD)
+        write(out, stateHash);
+    else {
+        uint64_t recorded = 0;
+        if (read(in, recorded) && recorded != stateHash && _divergedTick == SIZE_MAX) {
+            _divergedTick = _tick;
+            printf("The physics playback diverged from the recording at tick %zu.\n", _tick);
+        }
+    }
+    ++_tick;
+}
+
+void PhysicsReplay::captureStates() {
+    auto& world = RigidBodyWorld::get();
+    states.resize(world.size());
+    for (size_t i = 0, n = states.size(); i < n; ++i)
+        states[i] = world.state(i);
+}
+
+// FNV-1a over the raw bytes, so it only matches if every state is bit for bit the same
+uint64_t PhysicsReplay::hash(const std::vector<RigidBodyWorld::BodyState>& states) {
+    auto h = 14695981039346656037ull;
+    const auto bytes = (const uint8_t*)states.data();
+    for (size_t i = 0, n = states.size() * sizeof(RigidBodyWorld::BodyState); i < n; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
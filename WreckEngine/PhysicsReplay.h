@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "RigidBody.h"
+
+/*
+----------------------------------------------------------------------
+- Records a physics session tick by tick, so it can be replayed exactly later on, e.g. headless to benchmark or bisect physics changes
+- Only what changes between ticks is recorded, as the simulation reproduces everything it does itself
+  - Before each tick, every body is compared to the state the last tick left it in,
+    and the ones that differ (moved by game code, pushed by a force, woken up, ...) are written out whole
+  - After each tick, a hash of every body's state is written, so a replay can tell exactly which tick it first diverged at
+- Replays have to start from the same scene, built the same way, as bodies are matched up by their order in the world
+  - The physics benchmark's scenes can be recorded and replayed headless (see PhysicsBenchmark)
+  - The recording starts with every body's state, which the replay restores
+  - Both drop the collision manager's caches when they start, so nothing from before the recording started can affect it
+  - Bodies can't be added or removed while recording; doing so ends the recording
+  - Mass, restitution, and anything else about a body that the game sets directly isn't recorded
+- It's only reproducible if nothing touches the bodies mid-tick, which is what deterministic mode is for (see Source.cpp)
+- The layout is in native byte order, as recordings are meant to be replayed on the same kind of machine:
+  - header: magic, version, step length, body count, then the state of every body
+  - per tick: the number of bodies that changed, (index, state) for each, then the hash of every body's state after the tick
+----------------------------------------------------------------------
+*/
+class PhysicsReplay {
+public:
+    static PhysicsReplay& get() { static PhysicsReplay replay; return replay; }
+
+    // these return false (and stay idle) if the file can't be opened, or doesn't match the scene
+    bool startRecording(const std::string& path, double step);
+    bool startPlayback(const std::string& path);
+    void stop();
+
+    bool recording() const { return mode == Mode::RECORD; }
+    bool playing()   const { return mode == Mode::PLAYBACK; }
+
+    // every physics tick has to be wrapped in these, which do nothing else while idle
+    // beginTick flushes the bodies made and destroyed since the last tick into the world (see RigidBodyWorld::flush) before it compares anything,
+    // and returns false once a playback has run out of ticks, in which case the tick shouldn't be run
+    bool beginTick();
+    void endTick();
+
+    // the step length the playback was recorded with
+    double step() const { return _step; }
+    size_t tick() const { return _tick; }
+    // the first tick that didn't end the way it did when it was recorded, or SIZE_MAX if they all have
+    size_t divergedTick() const { return _divergedTick; }
+
+    // hashes the state of every body in the world
+    static uint64_t hash(const std::vector<RigidBodyWorld::BodyState>& states);
+
+private:
+    enum class Mode { IDLE, RECORD, PLAYBACK };
+    static constexpr uint32_t MAGIC = 0x4c505257; // "WRPL"
+    static constexpr uint32_t VERSION = 1;
+
+    struct Change {
+        uint32_t index;
+        RigidBodyWorld::BodyState state;
+    };
+
+    void captureStates();
+
+    Mode mode = Mode::IDLE;
+    std::ofstream out;
+    std::ifstream in;
+    double _step = 0;
+    size_t _tick = 0, _divergedTick = SIZE_MAX;
+
+    std::vector<RigidBodyWorld::BodyState> states; // every body's state as of the end of the last tick
+    std::vector<Change> changes;
+};
@@ -0,0 +1,42 @@
+#include "PoseBuffer.h"
+
+void PoseBuffer::publish(const Transform& t, double interval) {
+    const auto computed = t.getComputed();
+    Pose pose;
+    pose.position = computed.position();
+    pose.rotation = computed.rotation();
+    pose.scale    = computed.scale();
+
+    const auto seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    prev = seq ? curr : pose; // the first pose has nothing to interpolate from
+    curr = pose;
+    publishTime = Time::now();
+    this->interval = interval;
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+mat4 PoseBuffer::world(Time::time_point now) const {
+    Pose a, b;
+    Time::time_point time;
+    double length;
+    while (true) {
+        const auto seq = sequence.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        a = prev;
+        b = curr;
+        time = publishTime;
+        length = interval;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == seq) break;
+    }
+
+    const auto alpha = length > 0 ? (float)glm::clamp(Time::get_duration(time, now) / length, 0.0, 1.0) : 1.f;
+    const auto rotation = alpha < 1 && a.rotation.vals != b.rotation.vals ? quat::slerp(a.rotation, b.rotation, alpha) : b.rotation;
+    return composeTRS(glm::mix(a.position, b.position, alpha), rotation, glm::mix(a.scale, b.scale, alpha));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+#include "Time.h"
+#include "Transform.h"
+
+/*
+----------------------------------------------------------------------
+- A double-buffered snapshot of a transform's last two poses, written by the thread that moves it and read by the render thread
+  - The writer publishes once it's done with a whole update, so the reader never sees a transform halfway through one
+  - The reader interpolates between the two poses, running one update behind so it always has a pose to move towards
+    - This decouples the render rate from the update rate; rendering at 144Hz from a 120Hz physics thread is still smooth
+- Reads and writes are synchronized with a sequence lock rather than a mutex, so the writer never waits on the render thread
+  - The sequence is odd while a write is in progress; readers retry if it was odd or changed while they were copying
+  - Only one thread may publish to a buffer
+----------------------------------------------------------------------
+*/
+class PoseBuffer {
+public:
+    struct Pose {
+        vec3 position, scale { 1 };
+        quat rotation;
+    };
+
+    PoseBuffer() = default;
+    // copies start out empty; a buffer belongs to the transform it was published from
+    PoseBuffer(const PoseBuffer&) : PoseBuffer() {}
+    PoseBuffer& operator=(const PoseBuffer&) { return *this; }
+
+    // records the transform's current (computed) pose, which is expected to be reached [interval] seconds from now
+    void publish(const Transform& t, double interval);
+    bool published() const { return sequence.load(std::memory_order_acquire) != 0; }
+
+    // the world matrix interpolated between the last two poses for time [now]
+    mat4 world(Time::time_point now) const;
+
+private:
+    std::atomic<uint32_t> sequence { 0 };
+    Pose prev, curr;
+    Time::time_point publishTime;
+    double interval = 0;
+};
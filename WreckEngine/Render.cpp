@@ -12,11 +12,9 @@ using namespace Render;
 CameraData::CameraData(Camera* c) : cam(c) {
     if (!cam) return;
     viewProjection = cam->getCamMat();
-    {
-        auto t = cam->transform.getComputed();
-        position = t->position();
-        forward = t->forward();
-    }
+    const auto t = cam->transform.getComputed();
+    position = t.position();
+    forward = t.forward();
 }
 
 Event::Handler Target::resizeHandler = Event::make_handler<Window::ResizeHandler>(&resizeTargets);
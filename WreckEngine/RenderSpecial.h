@@ -19,8 +19,8 @@ namespace Render {
                 deferred.objects.preprocess([&](auto& drawCalls) {
                     std::sort(begin(drawCalls), end(drawCalls), [camDir](DrawCallInfo& drawA, DrawCallInfo& drawB) {
                         if (!(drawA.data.entity && drawB.data.entity)) return true;
-                        float aProj = glm::dot(camDir, drawA.data.entity->transform.getComputed()->position()); 
-                        float bProj = glm::dot(camDir, drawA.data.entity->transform.getComputed()->position());
+                        float aProj = glm::dot(camDir, drawA.data.entity->transform.getComputed().position()); 
+                        float bProj = glm::dot(camDir, drawA.data.entity->transform.getComputed().position());
                         return aProj < bProj; // closer objects come first
                     });
                 });
@@ -59,8 +59,8 @@ namespace Render {
                 deferred.objects.preprocess([&](auto& drawCalls) {
                     std::sort(begin(drawCalls), end(drawCalls), [camDir](DrawCallInfo& drawA, DrawCallInfo& drawB) {
                         if (!(drawA.data.entity && drawB.data.entity)) return true;
-                        float aProj = glm::dot(camDir, drawA.data.entity->transform.getComputed()->position());
-                        float bProj = glm::dot(camDir, drawA.data.entity->transform.getComputed()->position());
+                        float aProj = glm::dot(camDir, drawA.data.entity->transform.getComputed().position());
+                        float bProj = glm::dot(camDir, drawA.data.entity->transform.getComputed().position());
                         return aProj > bProj; // further objects come first
                     });
                 });
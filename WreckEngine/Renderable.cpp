@@ -3,7 +3,7 @@
 #include "glm/gtx/transform.hpp"
 
 void Renderable::draw(Transform* t, Entity* entity) {
-    draw(t->getMats()->world, entity);
+    draw(t->getWorldMat(), entity);
 }
 
 void Renderable::draw(const mat4& world, Entity* entity) {
@@ -15,7 +15,7 @@ public:
     Render::MaterialPass* renderer;
 
     void draw(Transform* t, Entity* entity) override;
-    virtual void draw(const mat4& world, Entity* entity);
+    void draw(const mat4& world, Entity* entity) override;
     void setWorldMatrix(const mat4& world);
 
     static GLtexture genTexture2D(const char* texFile);
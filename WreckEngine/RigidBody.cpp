@@ -1,57 +1,299 @@
 #include "RigidBody.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <functional>
 
-void RigidBody::update(double dt) {
-    updateVel(dt);
-    updateAngVel(dt);
+#include "thread_pool.h"
+#include "ColliderEntity.h"
 
-    netForce = {};
-    netAngAccel = {};
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define RIGIDBODY_SSE
+#include <emmintrin.h>
+#endif
+
+RigidBody::RigidBody(ColliderEntity* owner) {
+    updateMass();
+    world().add(this, owner);
+}
+
+// bodies are the last member of their entities, so this runs before any of the entity is torn down;
+// it's queued for removal from both worlds by the time the lock is released, so no later tick can read it
+RigidBody::~RigidBody() {
+    std::lock_guard<std::recursive_mutex> lock(world().tickMutex);
+    world().remove(this);
+}
+
+void RigidBody::applyForce(const vec3 f) {
+    visit([f](auto& w, uint32_t i) { w.force.set(i, w.force[i] + f); w.asleep[i] = false; }
+        , [f](auto& s) { s.force += f; s.asleep = false; });
+}
+
+void RigidBody::applyAngAccel(const vec3 a) {
+    visit([a](auto& w, uint32_t i) { w.angAccel.set(i, w.angAccel[i] + a); w.asleep[i] = false; }
+        , [a](auto& s) { s.angAccel += a; s.asleep = false; });
 }
 
-void RigidBody::updateVel(double dt) {
-    vel += _invMass * (float)dt * netForce;
+bool RigidBody::resting() const {
+    const auto minSq = MIN_VEL * MIN_VEL;
+    const auto v = vel(), w = angVel();
+    return glm::dot(v, v) < minSq && glm::dot(w, w) < minSq;
+}
+
+void RigidBody::sleep() {
+    visit([](auto& w, uint32_t i) {
+        w.asleep[i] = true;
+        for (auto soa : { &w.vel, &w.angVel, &w.force, &w.angAccel })
+            soa->set(i, {});
+    }, [](auto& s) {
+        s.asleep = true;
+        s.vel = s.angVel = s.force = s.angAccel = vec3();
+    });
+}
+
+void RigidBody::updateMass() {
+    const auto invMass = _mass ? 1.f / _mass : 0;
+    const auto gravity = _mass ? -RigidBodyWorld::GRAVITY * (1 - _floating) : 0;
+    visit([=](auto& w, uint32_t i) { w.invMass[i] = invMass; w.gravity[i] = gravity; }
+        , [=](auto& s) { s.invMass = invMass; s.gravity = gravity; });
+}
+
+void RigidBodyWorld::add(RigidBody* body, ColliderEntity* owner) {
+    std::lock_guard<std::mutex> lock(pendingMut);
+    pendingAdds.push_back({ body, owner });
+}
 
-    if (_speed < MIN_VEL) {
-        _vel = {};
-        _speed = 0;
+// the slot stays taken until the next flush, but nothing reads it once its entity is gone
+void RigidBodyWorld::remove(RigidBody* body) {
+    std::lock_guard<std::mutex> lock(pendingMut);
+    const auto index = body->index.load(std::memory_order_relaxed);
+    if (index != RigidBody::UNPLACED) {
+        pendingRemoves.push_back(index);
+        return;
     }
-    else {
-        if (_speed > MAX_VEL) {
-            _vel *= MAX_VEL / _speed;
-            _speed = MAX_VEL;
-        }
-        _heading = _vel * (1.f / _speed);
+
+    const auto it = std::find_if(begin(pendingAdds), end(pendingAdds), [body](const auto& add) { return add.first == body; });
+    if (it != end(pendingAdds)) pendingAdds.erase(it);
+}
+
+// removals go first, and highest first, so the last body (which fills each removed slot) is never one that's waiting to be removed too
+void RigidBodyWorld::flush() {
+    std::lock_guard<std::mutex> lock(pendingMut);
+    std::sort(begin(pendingRemoves), end(pendingRemoves), std::greater<uint32_t>());
+    for (const auto index : pendingRemoves) erase(index);
+    for (const auto [body, owner] : pendingAdds) place(body, owner);
+    pendingRemoves.clear();
+    pendingAdds.clear();
+}
+
+void RigidBodyWorld::place(RigidBody* body, ColliderEntity* owner) {
+    const auto& s = body->staged;
+    bodies.push_back(body);
+    owners.push_back(owner);
+    pos.push_back({});
+    vel.push_back(s.vel);
+    angVel.push_back(s.angVel);
+    force.push_back(s.force);
+    angAccel.push_back(s.angAccel);
+    motion.push_back({});
+    invMass.push_back(s.invMass);
+    gravity.push_back(s.gravity);
+    asleep.push_back(s.asleep);
+    moving.push_back(false);
+    body->index.store((uint32_t)(bodies.size() - 1), std::memory_order_release);
+}
+
+void RigidBodyWorld::erase(uint32_t index) {
+    // the last body takes the removed one's place
+    const auto last = bodies.size() - 1;
+    if (index != last) {
+        bodies[index] = bodies[last];
+        bodies[index]->index.store(index, std::memory_order_release);
+        owners[index] = owners[last];
+        for (auto soa : { &pos, &vel, &angVel, &force, &angAccel, &motion })
+            soa->set(index, (*soa)[last]);
+        invMass[index] = invMass[last];
+        gravity[index] = gravity[last];
+        asleep[index] = asleep[last];
+        moving[index] = moving[last];
     }
-    //this is enough to determine if there's an issue
-    assert(!NaN_CHECK(_speed));
+
+    bodies.pop_back();
+    owners.pop_back();
+    for (auto soa : { &pos, &vel, &angVel, &force, &angAccel, &motion })
+        soa->pop_back();
+    invMass.pop_back();
+    gravity.pop_back();
+    asleep.pop_back();
+    moving.pop_back();
+}
+
+RigidBodyWorld::BodyState RigidBodyWorld::state(size_t index) const {
+    BodyState s;
+    std::memset(&s, 0, sizeof(s)); // so padding in the math types (if any) can't make equal states compare differently
+
+    const auto owner = owners[index];
+    s.position = owner->transform.position();
+    s.scale    = owner->transform.scale();
+    s.rotation = owner->transform.rotation();
+    s.vel      = vel[index];
+    s.angVel   = angVel[index];
+    s.force    = force[index];
+    s.angAccel = angAccel[index];
+    s.restTime = bodies[index]->restTime;
+    s.flags    = (owner->active ? BodyState::ACTIVE : 0) | (asleep[index] ? BodyState::ASLEEP : 0);
+    return s;
 }
 
-void RigidBody::updateAngVel(double dt) {
-    angVel += (float)dt * netAngAccel;
+void RigidBodyWorld::state(size_t index, const BodyState& s) {
+    auto owner = owners[index];
+    owner->transform.position = s.position;
+    owner->transform.scale    = s.scale;
+    owner->transform.rotation = s.rotation;
+    vel.set(index, s.vel);
+    angVel.set(index, s.angVel);
+    force.set(index, s.force);
+    angAccel.set(index, s.angAccel);
+    motion.set(index, {}); // the body was put here, rather than moving here
+    bodies[index]->restTime = s.restTime;
+    owner->active = (s.flags & BodyState::ACTIVE) != 0;
+    asleep[index] = (s.flags & BodyState::ASLEEP) != 0;
+    owner->collider()->update();
+}
 
-    if (_angSpeed < MIN_VEL) {
-        _angVel = {};
-        _angSpeed = 0;
+void RigidBodyWorld::update(float dt) {
+    flush();
+
+    const auto count = bodies.size();
+    for (size_t i = 0; i < count; ++i) {
+        const auto owner = owners[i];
+        moving[i] = owner->active && !asleep[i];
+        if (moving[i]) pos.set(i, owner->transform.position());
     }
-    else {
-        if (_angSpeed > MAX_VEL) {
-            _angVel *= MAX_VEL / _angSpeed;
-            _angSpeed = MAX_VEL;
+
+    if (parallel)
+        thread_pool::get().parallel_for(count, PARALLEL_GRAIN, [&](size_t begin, size_t end, size_t) { integrate(begin, end, dt); });
+    else
+        integrate(0, count, dt);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!moving[i]) {
+            motion.set(i, {});
+            continue;
         }
-        _angHeading = _angVel * (1.f / _angSpeed);
+
+        auto owner = owners[i];
+        const auto p = pos[i];
+        const auto start = owner->transform.position();
+        motion.set(i, p - start);
+        if (p != start) owner->transform.position = p;
+        const auto w = angVel[i];
+        if (w != vec3()) owner->transform.rotate(w * dt);
+        owner->collider()->update();
+        assert(!NaN_CHECK(p.x));
+    }
+}
+
+void RigidBodyWorld::publishPoses(double interval) {
+    flush(); // the owners of bodies destroyed since the last tick are gone
+    for (auto owner : owners) {
+        if (owner->active) owner->renderPose.publish(owner->transform, interval);
     }
 }
 
-void RigidBody::applyGravity() {
-    constexpr float g = 9.8f;
-    netForce += vec3(0, _mass * -g * (1 - _floating), 0);
+namespace {
+    // zeroes velocities under MIN_VEL and scales down ones over MAX_VEL
+    inline vec3 clampVel(const vec3 v) {
+        const auto speed = glm::length(v);
+        if (speed < MIN_VEL) return vec3();
+        return speed > MAX_VEL ? v * (MAX_VEL / speed) : v;
+    }
+
+#ifdef RIGIDBODY_SSE
+    inline __m128 length(const __m128 x, const __m128 y, const __m128 z) {
+        return _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    }
+
+    inline void clampVel(__m128& x, __m128& y, __m128& z) {
+        const auto speed = length(x, y, z);
+        // dividing by a speed of 0 gives infinity, which the min takes care of
+        const auto scale = _mm_min_ps(_mm_set1_ps(1), _mm_div_ps(_mm_set1_ps(MAX_VEL), speed));
+        const auto factor = _mm_and_ps(_mm_cmpge_ps(speed, _mm_set1_ps(MIN_VEL)), scale);
+        x = _mm_mul_ps(x, factor);
+        y = _mm_mul_ps(y, factor);
+        z = _mm_mul_ps(z, factor);
+    }
+
+    // v += dt * (a - drag * |v| * v), then clamped
+    inline void integrateVel(float* vx, float* vy, float* vz, const __m128 ax, const __m128 ay, const __m128 az, const __m128 drag, const __m128 dt) {
+        auto x = _mm_loadu_ps(vx), y = _mm_loadu_ps(vy), z = _mm_loadu_ps(vz);
+        const auto dragScale = _mm_mul_ps(drag, length(x, y, z));
+        x = _mm_add_ps(x, _mm_mul_ps(dt, _mm_sub_ps(ax, _mm_mul_ps(dragScale, x))));
+        y = _mm_add_ps(y, _mm_mul_ps(dt, _mm_sub_ps(ay, _mm_mul_ps(dragScale, y))));
+        z = _mm_add_ps(z, _mm_mul_ps(dt, _mm_sub_ps(az, _mm_mul_ps(dragScale, z))));
+        clampVel(x, y, z);
+        _mm_storeu_ps(vx, x);
+        _mm_storeu_ps(vy, y);
+        _mm_storeu_ps(vz, z);
+    }
+#endif
 }
 
-// the coefficient here is equivalent to 0.5 * density of fluid (here just air) * C_d (drag coefficient), which we boil down to C_d
-// C_d is dependent on the object's shape and the Reynolds Number, R_e = internal forces / viscous forces = mag(v) * D / viscosity, 
-// where D is some characteristic diameter or linear dimension and viscosity is the kinematic viscosity = viscosity / density
-vec3 RigidBody::quadDrag(float c_d, vec3 v, vec3 h)
-{
-    return c_d * glm::dot(v, v) * h;
-}
\ No newline at end of file
+/*
+----------------------------------------------------------------------
+- Semi-implicit Euler: the velocities are updated from the accumulated forces first, and the positions from the new velocities
+  - Drag is computed from the velocity before the update, and scaled by the inverse mass like any other force
+  - Angular acceleration is applied directly, as there's no inertia tensor yet
+- Bodies that aren't moving integrate with a timestep of 0, which leaves them exactly as they are without branching
+- The accumulated forces are cleared for every body, moving or not
+----------------------------------------------------------------------
+*/
+void RigidBodyWorld::integrate(size_t begin, size_t end, float dt) {
+    auto i = begin;
+
+#ifdef RIGIDBODY_SSE
+    const auto zero = _mm_setzero_ps();
+    const auto linearDrag = _mm_set1_ps(LINEAR_DRAG), angularDrag = _mm_set1_ps(ANGULAR_DRAG);
+    for (; i + 4 <= end; i += 4) {
+        const auto isMoving = _mm_cmpneq_ps(_mm_set_ps(moving[i + 3], moving[i + 2], moving[i + 1], moving[i]), zero);
+        const auto step = _mm_and_ps(isMoving, _mm_set1_ps(dt));
+
+        const auto inv = _mm_loadu_ps(&invMass[i]);
+        integrateVel(&vel.x[i], &vel.y[i], &vel.z[i]
+                   , _mm_mul_ps(inv, _mm_loadu_ps(&force.x[i]))
+                   , _mm_add_ps(_mm_mul_ps(inv, _mm_loadu_ps(&force.y[i])), _mm_loadu_ps(&gravity[i]))
+                   , _mm_mul_ps(inv, _mm_loadu_ps(&force.z[i]))
+                   , _mm_mul_ps(inv, linearDrag), step);
+        integrateVel(&angVel.x[i], &angVel.y[i], &angVel.z[i]
+                   , _mm_loadu_ps(&angAccel.x[i]), _mm_loadu_ps(&angAccel.y[i]), _mm_loadu_ps(&angAccel.z[i])
+                   , angularDrag, step);
+
+        _mm_storeu_ps(&pos.x[i], _mm_add_ps(_mm_loadu_ps(&pos.x[i]), _mm_mul_ps(step, _mm_loadu_ps(&vel.x[i]))));
+        _mm_storeu_ps(&pos.y[i], _mm_add_ps(_mm_loadu_ps(&pos.y[i]), _mm_mul_ps(step, _mm_loadu_ps(&vel.y[i]))));
+        _mm_storeu_ps(&pos.z[i], _mm_add_ps(_mm_loadu_ps(&pos.z[i]), _mm_mul_ps(step, _mm_loadu_ps(&vel.z[i]))));
+
+        for (auto soa : { &force, &angAccel }) {
+            _mm_storeu_ps(&soa->x[i], zero);
+            _mm_storeu_ps(&soa->y[i], zero);
+            _mm_storeu_ps(&soa->z[i], zero);
+        }
+    }
+#endif
+
+    for (; i < end; ++i) {
+        const auto step = moving[i] ? dt : 0.f;
+
+        auto v = vel[i];
+        const auto accel = invMass[i] * (force[i] - LINEAR_DRAG * glm::length(v) * v) + vec3(0, gravity[i], 0);
+        v = clampVel(v + step * accel);
+        vel.set(i, v);
+        pos.set(i, pos[i] + step * v);
+
+        auto w = angVel[i];
+        w = clampVel(w + step * (angAccel[i] - ANGULAR_DRAG * glm::length(w) * w));
+        angVel.set(i, w);
+
+        force.set(i, {});
+        angAccel.set(i, {});
+    }
+}
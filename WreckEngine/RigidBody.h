@@ -1,34 +1,157 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
 #include "MarchMath.h"
 #include "property.h"
 
+class ColliderEntity;
+class RigidBody;
+
 const float MIN_VEL = .001f;
 const float MAX_VEL = 1000.f;
+const float MIN_BOUNCE_VEL = .5f; // contacts closing slower than this don't bounce, so resting contacts can settle
+
+/*
+----------------------------------------------------------------------
+- Stores the simulation state of every rigid body in flat arrays, one per component, and integrates them all in one batched pass
+  - Bodies are kept packed; removing one moves the last body into its place
+  - RigidBody is just a handle to its slot, and the world keeps each handle's index up to date as bodies move around
+- Bodies are made and destroyed on the update thread, so adding and removing them is queued, and only applied when the world is flushed
+  - That happens at the start of every tick, before anything in it reads the world, so no index into it is held across a flush
+  - Until then, a new body keeps its state in its handle, so it can be set up as soon as it's made
+  - Destroying a body waits for the tick running at the time (if any) to finish, as it may still be reading the body's entity
+  - The arrays only grow or move bodies around during a flush, but game code touching bodies mid-tick still races with the tick,
+    as it always has; deterministic mode is the way to avoid that
+- The integration runs 4 bodies at a time with SIMD, split across the thread pool
+  - Positions are gathered from the transforms beforehand, so anything that moves a transform directly still works
+  - Each transform and collider is written back once afterwards, on the calling thread, as updating a collider queues a debug draw, which isn't thread safe
+- Forces are accumulated between updates through RigidBody::applyForce; gravity and drag are built in
+- Sleeping bodies and inactive entities aren't moved at all
+- Each body's displacement over the last update is kept, so collision detection can sweep it along its path
+----------------------------------------------------------------------
+*/
+class RigidBodyWorld {
+public:
+	static RigidBodyWorld& get() { static RigidBodyWorld world; return world; }
+
+	static constexpr float GRAVITY = 9.8f;
+	// quadratic drag coefficients; there's no mass involved, it's all velocity dependent
+	static constexpr float LINEAR_DRAG = 1.f, ANGULAR_DRAG = 2.f;
+
+	// whatever runs physics ticks has to hold this while it does, so bodies destroyed on other threads wait for the tick to finish
+	// it's recursive so ticks can make bodies, but bodies destroyed from inside a tick would still be freed while the tick is using them
+	std::recursive_mutex tickMutex;
+
+	// the integration is split across the thread pool in chunks of this many bodies
+	static constexpr size_t PARALLEL_GRAIN = 1024;
+	bool parallel = true;
+
+	// everything about a body that changes as the simulation runs, with no padding so states can be compared and hashed as bytes
+	struct BodyState {
+		enum : uint32_t { ACTIVE = 1, ASLEEP = 2 };
+		vec3 position, scale;
+		quat rotation;
+		vec3 vel, angVel, force, angAccel;
+		float restTime;
+		uint32_t flags;
+	};
+
+	size_t size() const { return bodies.size(); }
+	ColliderEntity* owner(size_t index) const { return owners[index]; }
+	BodyState state(size_t index) const;
+	// overwrites the body's state, including its entity's transform
+	void state(size_t index, const BodyState& s);
+	// places the bodies made and drops the ones destroyed since the last flush; update() does this itself,
+	// but anything that reads the world before updating it has to call it first (PhysicsReplay::beginTick does, at the start of every tick)
+	void flush();
+	void update(float dt);
+	// publishes every active body's pose for the render thread, to be reached [interval] seconds from now
+	void publishPoses(double interval);
+
+private:
+	friend class RigidBody;
+
+	void add(RigidBody* body, ColliderEntity* owner);
+	void remove(RigidBody* body);
+	void place(RigidBody* body, ColliderEntity* owner);
+	void erase(uint32_t index);
+	void integrate(size_t begin, size_t end, float dt);
+
+	std::mutex pendingMut;
+	std::vector<std::pair<RigidBody*, ColliderEntity*>> pendingAdds; // guarded by pendingMut, as are unplaced bodies' staged states
+	std::vector<uint32_t> pendingRemoves;
+
+	std::vector<RigidBody*> bodies;
+	std::vector<ColliderEntity*> owners;
+
+	vec3_soa pos, vel, angVel, force, angAccel, motion;
+	std::vector<float> invMass, gravity; // gravity is the acceleration it causes, which is 0 for floating and infinite mass bodies
+	std::vector<uint8_t> asleep, moving; // moving is refreshed every update, and is only set for awake bodies of active entities
+};
 
 class RigidBody {
 public:
-	vec3 netForce, netAngAccel;
+	explicit RigidBody(ColliderEntity* owner);
+	~RigidBody();
+
+	RigidBody(const RigidBody&) = delete;
+	RigidBody& operator=(const RigidBody&) = delete;
 
-	void update(double dt);
-	void updateVel(double dt);
-	void updateAngVel(double dt);
+	vec3 vel()    const { return visit([](auto& w, uint32_t i) { return w.vel[i]; },    [](auto& s) { return s.vel; }); }
+	vec3 angVel() const { return visit([](auto& w, uint32_t i) { return w.angVel[i]; }, [](auto& s) { return s.angVel; }); }
+	float invMass() const { return visit([](auto& w, uint32_t i) { return w.invMass[i]; }, [](auto& s) { return s.invMass; }); }
+	// how far the body moved in the last update, which is 0 for bodies that weren't moving
+	vec3 motion() const { return visit([](auto& w, uint32_t i) { return w.motion[i]; }, [](auto&) { return vec3(); }); }
 
-	void applyGravity();
-	vec3 quadDrag(float c_d, vec3 v, vec3 h);
+	// setting either velocity or applying anything wakes the body back up
+	void vel(const vec3 v)    { visit([v](auto& w, uint32_t i) { w.vel.set(i, v);    w.asleep[i] = false; }, [v](auto& s) { s.vel = v;    s.asleep = false; }); }
+	void angVel(const vec3 v) { visit([v](auto& w, uint32_t i) { w.angVel.set(i, v); w.asleep[i] = false; }, [v](auto& s) { s.angVel = v; s.asleep = false; }); }
+	// accumulated until the next update
+	void applyForce(const vec3 f);
+	void applyAngAccel(const vec3 a);
+
+	bool resting() const;
+	// sleeping bodies are skipped by the integrator and the narrow phase
+	bool asleep() const { return visit([](auto& w, uint32_t i) { return w.asleep[i] != 0; }, [](auto& s) { return s.asleep; }); }
+	void sleep();
+	void wake() { visit([](auto& w, uint32_t i) { w.asleep[i] = false; }, [](auto& s) { s.asleep = false; }); restTime = 0; }
+	float restTime = 0; // how long the body has been resting while awake
 
 private:
-	ACCS_GS   (private, float, floating) = 0;
+	friend class RigidBodyWorld;
+	static RigidBodyWorld& world() { return RigidBodyWorld::get(); }
+	void updateMass();
+
+	// runs [onPlaced] on the body's slot in the world, or [onStaged] on its staged state, under the world's lock, until it's been placed
+	template<class OnPlaced, class OnStaged>
+	std::invoke_result_t<OnPlaced, RigidBodyWorld&, uint32_t> visit(OnPlaced&& onPlaced, OnStaged&& onStaged) const {
+		auto& w = world();
+		auto i = index.load(std::memory_order_acquire);
+		if (i != UNPLACED) return onPlaced(w, i);
+
+		std::lock_guard<std::mutex> lock(w.pendingMut);
+		i = index.load(std::memory_order_relaxed);
+		return i != UNPLACED ? onPlaced(w, i) : onStaged(staged);
+	}
+
+	static constexpr uint32_t UNPLACED = UINT32_MAX;
+	std::atomic<uint32_t> index { UNPLACED }; // only changed during a flush
+	// the body's state until it's placed in the world, which starts out from this
+	mutable struct Staged {
+		vec3 vel, angVel, force, angAccel;
+		float invMass = 1, gravity = 0;
+		bool asleep = false;
+	} staged;
+
+	ACCS_GS_C (private, float, floating, { return _floating; }, { _floating = value; updateMass(); }) = 0;
 	ACCS_GS   (private, short, solid)    = 1;
 
-	ACCS_GS_C (private, float, mass, { return _mass; }, { _mass = value; _invMass = value ? 1.f / value : 0; }) = 1; // infinite mass is represented by 0; this means gravity won't work
-	ACCS_G    (private, float, invMass) = 1;
+	ACCS_GS_C (private, float, mass, { return _mass; }, { _mass = value; updateMass(); }) = 1; // infinite mass is represented by 0; this means gravity won't work
 	// 0 is perfectly inelastic, i.e. objects stick together, 1 is perfectly elastic, i.e. objects bounce apart entirely
 	ACCS_GS   (private, float, restitution) = 0.8f;
-	
-	float _speed = 0, _angSpeed = 0;
-	PROP_GS (private, RigidBody, vec3, vel,    { return _vel;    }, { _speed = glm::length(value);    return _vel = value; });
-	PROP_GS (private, RigidBody, vec3, angVel, { return _angVel; }, { _angSpeed = glm::length(value); return _angVel = value; });
-    ACCS_G(private, vec3, heading)    { 1, 0, 0 };
-    ACCS_G(private, vec3, angHeading) { 1, 0, 0 };
-};
\ No newline at end of file
+};
@@ -11,7 +11,10 @@ unique<GLEWmanager> glew;
 
 #pragma endregion
 
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
@@ -26,6 +29,10 @@ unique<GLEWmanager> glew;
 #include "UI.h"
 
 #include "Update.h"
+#include "FixedTimestep.h"
+#include "PhysicsBenchmark.h"
+#include "PhysicsReplay.h"
+#include "RigidBody.h"
 #include "HotSwap.h"
 
 #include "TriPlay.h"
@@ -88,8 +95,40 @@ void initGraphics() {
         GLstate<GL_CULL_FACE, GL_ENABLE_BIT>{ true }.apply();
 }
 
+// physics always steps by the same amount, however long the thread's frames actually take
+FixedTimestep physicsStep(1.0 / 120, 4);
+std::mutex physicsMutex; // only contended while switching in or out of deterministic mode
+
+// in deterministic mode, physics ticks run on the update thread right after the game update instead of on their own thread,
+// so nothing can touch the bodies mid-tick, and every tick can be recorded and replayed exactly (see PhysicsReplay)
+std::atomic<bool> deterministicPhysics { false };
+const char* physicsRecordingPath = "physics.wrpl";
+
+// [updateThread] is whether this is the update thread, which only runs physics in deterministic mode; the physics thread runs it otherwise
+void stepPhysics(double delta, bool updateThread) {
+    // checked again under the lock, as the mode may have switched while waiting for it
+    if (deterministicPhysics != updateThread) return;
+    std::lock_guard<std::mutex> lock(physicsMutex);
+    if (deterministicPhysics != updateThread) return;
+    std::lock_guard<std::recursive_mutex> tick(RigidBodyWorld::get().tickMutex);
+
+    auto& replay = PhysicsReplay::get();
+
+    const auto steps = physicsStep.advance(delta);
+    size_t ran = 0;
+    for (; ran < steps && replay.beginTick(); ++ran) {
+        game->physicsUpdate(physicsStep.step());
+        replay.endTick();
+    }
+
+    // the recording stops by itself if bodies are added or removed, which ends deterministic mode along with it
+    if (updateThread && !replay.recording()) deterministicPhysics = false;
+
+    if (ran) RigidBodyWorld::get().publishPoses(physicsStep.step() * ran);
+}
+
 void physicsUpdate() {
-    game->physicsUpdate(Time::delta);
+    stepPhysics(Time::delta, false);
     game->postUpdate();
 }
 
@@ -99,12 +138,24 @@ void update() {
     // game update occurs before external updates
     // this enables simpler rules for clearing events per frame
     game->update(Time::delta);
+    stepPhysics(Time::delta, true);
     game->postUpdate();
 
     std::cout << std::flush; // flush all buffered output at least once per frame
 
     if (Keyboard::keyPressed(Keyboard::Key::Code::F11))
         Thread::Main::runAsync([] { Window::toggleFullScreen(); });
+    if (Keyboard::keyPressed(Keyboard::Key::Code::F9)) {
+        // recording switches to deterministic mode for as long as it runs
+        std::lock_guard<std::mutex> lock(physicsMutex);
+        auto& replay = PhysicsReplay::get();
+        if (replay.recording()) {
+            replay.stop();
+            deterministicPhysics = false;
+        }
+        else if (replay.startRecording(physicsRecordingPath, physicsStep.step()))
+            deterministicPhysics = true;
+    }
     if (Keyboard::keyPressed(Keyboard::Key::Code::F10)) {
         static bool vsync = true;
         vsync = !vsync;
@@ -147,6 +198,14 @@ void draw() {
 }
 
 int main(int argc, char** argv) {
+    // the benchmark runs without a window, or GL at all
+    if (argc > 1 && std::strcmp(argv[1], "--physics-benchmark") == 0)
+        return PhysicsBenchmark::run(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "--physics-record") == 0)
+        return PhysicsBenchmark::record(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "--physics-replay") == 0)
+        return PhysicsBenchmark::replay(argc - 2, argv + 2);
+
     glfw = make_unique<GLFWmanager>(1280, 720);
     glew = make_unique<GLEWmanager>();
 
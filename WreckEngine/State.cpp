@@ -1,24 +1,97 @@
 #include "State.h"
 
-void State::addEntity(shared<Entity> e) { entities.push_back(e); }
+#include "thread_pool.h"
 
-void State::update(double dt) {
-    for (auto e : entities) {
-        if (e->active)
-            e->update(dt);
+using ecs::EntityAdapter;
+
+namespace {
+    // parallel states get a pool of their own, as the shared one only runs one loop at a time,
+    // and an update waiting on the physics thread's loops is just what running it in parallel was meant to avoid
+    thread_pool& updatePool() { static thread_pool pool; return pool; }
+}
+
+ecs::entity State::addEntity(shared<Entity> e) {
+    const auto id = registry.create();
+    registry.add<EntityAdapter>(id, e);
+    return id;
+}
+
+void State::addSystem(Phase phase, System system) { systems.push_back({ phase, system, false, 0, 0 }); }
+
+// isolated entities go first, in parallel; the rest then go in order on this thread
+template<class F>
+void State::updateEntities(F&& f) {
+    auto& adapters = registry.pool<EntityAdapter>();
+    if (parallel) {
+        updatePool().parallel_for(adapters.size(), PARALLEL_GRAIN, [&adapters, &f](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                auto& e = *adapters[i].entity;
+                if (e.active && e.isolated) f(e);
+            }
+        });
+    }
+    for (size_t i = 0, n = adapters.size(); i < n; ++i) {
+        auto& e = *adapters[i].entity;
+        if (e.active && !(parallel && e.isolated)) f(e);
     }
 }
 
-void State::physicsUpdate(double dt) {
-    for (auto e : entities) {
-        if (e->active)
-            e->physicsUpdate(dt);
+void State::runSystems(Phase phase, double dt) {
+    if (!parallel) {
+        for (auto& system : systems) {
+            if (system.phase == phase)
+                system.run(registry, dt);
+        }
+        return;
     }
+
+    // systems join the batch until one conflicts with it, i.e. writes something the batch touches or reads something it writes
+    uint64_t batchReads = 0, batchWrites = 0;
+    for (auto& system : systems) {
+        if (system.phase != phase) continue;
+
+        const bool conflicts = (system.writes & (batchReads | batchWrites)) || (system.reads & batchWrites);
+        if (!system.declared || conflicts) {
+            runBatch(dt);
+            batchReads = batchWrites = 0;
+        }
+        if (!system.declared) {
+            system.run(registry, dt);
+            continue;
+        }
+
+        batch.push_back(&system);
+        batchReads  |= system.reads;
+        batchWrites |= system.writes;
+    }
+    runBatch(dt);
 }
 
-void State::draw() {
-    for (auto e : entities) {
-        if (e->active)
-            e->draw();
+void State::runBatch(double dt) {
+    if (batch.size() == 1) batch[0]->run(registry, dt);
+    else {
+        updatePool().parallel_for(batch.size(), 1, [this, dt](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i)
+                batch[i]->run(registry, dt);
+        });
     }
+    batch.clear();
+}
+
+void State::update(double dt) {
+    updateEntities([dt](Entity& e) { e.update(dt); });
+    runSystems(Phase::UPDATE, dt);
+}
+
+void State::physicsUpdate(double dt) {
+    updateEntities([dt](Entity& e) { e.physicsUpdate(dt); });
+    runSystems(Phase::PHYSICS, dt);
+}
+
+void State::draw() {
+    registry.each<EntityAdapter>([](ecs::entity, EntityAdapter& e) {
+        if (e.entity->active)
+            e.entity->draw();
+    });
+    runSystems(Phase::DRAW, 0);
 }
\ No newline at end of file
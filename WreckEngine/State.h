@@ -1,13 +1,15 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 
+#include "ECS.h"
 #include "Entity.h"
 #include "Event.h"
 
 //-----------------------------------------
 // States aren't too complex, but very powerful. They handle two things:
-//    - Entities
+//    - Entities, either as Entity objects or as components in its registry, which its systems run over
 //    - Events
 // It just handles entity updates and has an event handler. 
 // This simple combination allows for states to:
@@ -23,13 +25,52 @@ public:
 
     Event::Handler::func_t& handler_func = handler.handler;
 
-    void addEntity(shared<Entity> e);
+    // the entity is stored in the registry through an EntityAdapter, and is updated before the systems run
+    ecs::entity addEntity(shared<Entity> e);
+
+    // systems are run in the order they were added, each time the state runs their phase; draw systems are passed a dt of 0
+    enum class Phase { UPDATE, PHYSICS, DRAW };
+    using System = std::function<void(ecs::Registry&, double)>;
+    void addSystem(Phase phase, System system);
+
+    // declares which components the system reads and writes, so that a parallel state can run it alongside others it doesn't conflict with
+    // such a system must touch no other components, and can't create or destroy entities; it may be run on a pool thread
+    template<class... Reads, class... Writes>
+    void addSystem(Phase phase, ecs::reads<Reads...>, ecs::writes<Writes...>, System system) {
+        // the pools have to exist up front, as they can't be created while systems run in parallel
+        (registry.pool<Reads>(), ...);
+        (registry.pool<Writes>(), ...);
+        systems.push_back({ phase, system, true, ecs::Registry::mask<Reads...>(), ecs::Registry::mask<Writes...>() });
+    }
+
+    // spreads the work over the thread pool when set; everything else behaves the same
+    //   - isolated entities are updated in parallel, before the rest are updated in order on the calling thread
+    //   - consecutive declared systems that don't conflict run at the same time; undeclared ones run on their own, in order
+    //   - drawing is always done in order on the calling thread
+    // the work is spread over a pool of its own rather than the shared one, so it never waits on physics loops, or holds them up;
+    // the two pools' threads compete for the same cores though, so states should only be made parallel when their updates are heavy enough to gain from it
+    bool parallel = false;
+    static constexpr size_t PARALLEL_GRAIN = 64; // entities per chunk
+
+    ecs::Registry registry;
 
     void update(double dt);
     void physicsUpdate(double dt);
     void draw();
 private:
+    struct SystemEntry {
+        Phase phase;
+        System run;
+        bool declared;
+        uint64_t reads, writes;
+    };
+
     const std::string name;
-    std::vector<shared<Entity>> entities;
+    std::vector<SystemEntry> systems;
+    std::vector<SystemEntry*> batch;
     Event::Handler handler;
+
+    template<class F> void updateEntities(F&& f);
+    void runSystems(Phase phase, double dt);
+    void runBatch(double dt);
 };
\ No newline at end of file
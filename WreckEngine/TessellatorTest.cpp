@@ -240,7 +240,7 @@ int PlanetCSphere::update(const vec3& pos, const Camera* cam) {
 
     int activeCounter = 0;
     for (auto& plane : planes) {
-        //DrawDebug::get().drawDebugVector(plane.entity->transform.getComputed()->position(), plane.boundingPoint);
+        //DrawDebug::get().drawDebugVector(plane.entity->transform.getComputed().position(), plane.boundingPoint);
         activeCounter += plane.update(pos, cam, radius, translucent);
     }
     return activeCounter;
@@ -597,7 +597,7 @@ void TessellatorTest::update(double delta) {
     atmosData.sunPos->value = sun.light.position;
     atmosData.sunColor->value = sun.light.color;
 
-    auto pos = Camera::main->transform.getComputed()->position();
+    auto pos = Camera::main->transform.getComputed().position();
     auto dist = glm::length(pos) - RADIUS;
 
     int activeCounter = surface->update(pos, cam);
@@ -617,15 +617,12 @@ void TessellatorTest::update(double delta) {
 
     if (Keyboard::keyPressed(Keyboard::Key::Code::F1)) atmosphere->setActive(!atmosphere->active);
 
-    vec3 forward;
-    {
-        auto t = cam->transform.getComputed();
-        pos = t->position();
-        forward = t->forward();
-    }
+    const auto t = cam->transform.getComputed();
+    pos = t.position();
+    const auto forward = t.forward();
     controlText->setMessage(to_string(pos, 3)
                           + "\n" + std::to_string(glm::length(pos))
-                          + "\n" + to_string(quat::getEuler(cam->transform.getComputed()->rotation()))
+                          + "\n" + to_string(quat::getEuler(t.rotation()))
                           + "\nPlanes Active: " + std::to_string(activeCounter)
                           + "\nSeed: " + std::to_string(noiseData.seed->value)
                           + "\nExposure: " + std::to_string(exposure->value));
@@ -639,7 +636,7 @@ void TessellatorTest::postUpdate() {
 }
 
 void TessellatorTest::draw() {
-    auto pos = Camera::main->transform.getComputed()->position();
+    auto pos = Camera::main->transform.getComputed().position();
     waterData.prog.use();
     waterData.sunPos.update(sun.light.position);
 
@@ -714,7 +711,7 @@ void moveCamera(Entity* cameraControl, Entity* camera, float radius) {
     //
     //        auto look = camera->transform.position() + camera->transform.forward();
     //        camera->transform.rotate(dy, dx, 0);
-    //        camera->transform.position = look - camera->transform.getComputed()->forward();
+    //        camera->transform.position = look - camera->transform.getComputed().forward();
     //    }
     //}
 
@@ -733,7 +730,7 @@ void moveCamera(Entity* cameraControl, Entity* camera, float radius) {
         else if (Keyboard::keyDown(Keyboard::Key::Code::S)) { cameraControl->transform.position += pos * (towardSpeed * dt); camMoved = true; }
 
         if (camMoved) {
-            pos = camera->transform.getComputed()->position();
+            pos = camera->transform.getComputed().position();
             auto dist = glm::length(pos) - radius;
             adjustCamera(camera, dist);
         }
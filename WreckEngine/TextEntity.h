@@ -20,8 +20,8 @@ public:
 
     inline virtual void update(double dt) {
         //Text::draw(message, font.get(), vertical, horizontal, transform.position().x, transform.position().y, transform.scale().x, color);
-        auto position = transform.getComputed()->position();
-        auto scale = transform.getComputed()->scale();
+        auto position = transform.getComputed().position();
+        auto scale = transform.getComputed().scale();
 
         inst->alignHorizontal(horizontal);
         inst->alignVertical(vertical);
@@ -1,95 +1,140 @@
 #include "Transform.h"
 
-Transform::Transform() { updateRot(); }
+#include "TransformHierarchy.h"
+
+Transform::Transform() { updateDirections(); syncComputed(); }
+Transform::Transform(const Transform& other) : Transform() { *this = other; }
+Transform::~Transform() { if (inHierarchy.load(std::memory_order_acquire)) TransformHierarchy::get().remove(this); }
+
+// copies are parented the same way, but don't take any of the other's children
+Transform& Transform::operator=(const Transform& other) {
+    if (this == &other) return *this;
+    _position = other._position;
+    _scale = other._scale;
+    _rotation = other._rotation;
+    base_forward = other.base_forward;
+    base_up = other.base_up;
+    updateDirections();
+    parent(other._parent);
+    makeDirty();
+    return *this;
+}
 
 void Transform::makeDirty() {
-    dirtyComp = dirtyMats = true;
-    for (auto child : children)
-        child->makeDirty();
+    if (inHierarchy.load(std::memory_order_acquire)) {
+        publishLocal();
+        localDirty.store(true, std::memory_order_release);
+        TransformHierarchy::get().markDirty();
+    }
+    else syncComputed();
+}
+
+void Transform::syncComputed() {
+    Computed c;
+    c._position = _position;
+    c._scale    = _scale;
+    c._rotation = _rotation;
+    c._forward  = _forward;
+    c._up       = _up;
+    c._right    = _right;
+    publish(c);
+}
+
+void Transform::publishLocal() {
+    const auto seq = localSeq.load(std::memory_order_relaxed);
+    localSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    local = { _position, _scale, _rotation, base_forward, base_up };
+    localSeq.store(seq + 2, std::memory_order_release);
+}
+
+Transform::Local Transform::readLocal() const {
+    Local l;
+    while (true) {
+        const auto seq = localSeq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        l = local;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (localSeq.load(std::memory_order_relaxed) == seq) return l;
+    }
+}
+
+void Transform::publish(const Computed& c) {
+    const auto seq = computedSeq.load(std::memory_order_relaxed);
+    computedSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    computed = c;
+    computedSeq.store(seq + 2, std::memory_order_release);
 }
 
 Transform* Transform::parent() const { return _parent; }
 void Transform::parent(Transform* p) {
     if (p == _parent) return;
+    TransformHierarchy::get().parent(this, p);
+}
 
-    // current parent must remove us as a child
-    if (_parent) { _parent->children.erase(this); }
-    else { mats.release(); }
+// only built once it's asked for, from a snapshot of the computed transform
+mat4 Transform::getWorldMat() const {
+    if (inHierarchy.load(std::memory_order_acquire)) TransformHierarchy::get().flush();
 
-    // new parent must add us, or if there is none we no longer need to compute a transform
-    if (p) { p->children.insert(this); }
-    else { computed.release(); }
+    const auto cacheSeq = worldMatSeq.load(std::memory_order_acquire);
+    if (!(cacheSeq & 1)) {
+        const auto key = worldMatKey;
+        const auto mat = worldMat;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (worldMatSeq.load(std::memory_order_relaxed) == cacheSeq && key == computedSeq.load(std::memory_order_acquire)) return mat;
+    }
 
-    makeDirty();
-    _parent = p;
+    uint32_t seq;
+    const auto c = readComputed(seq);
+    const auto mat = composeTRS(c.position(), c.rotation(), c.scale());
+
+    // if another thread stored a matrix since the cache was checked, or is storing one now, it's left to that thread
+    auto expected = cacheSeq;
+    if (!(cacheSeq & 1) && worldMatSeq.compare_exchange_strong(expected, cacheSeq + 1, std::memory_order_relaxed)) {
+        std::atomic_thread_fence(std::memory_order_release);
+        worldMatKey = seq;
+        worldMat = mat;
+        worldMatSeq.store(cacheSeq + 2, std::memory_order_release);
+    }
+    return mat;
 }
 
-const Transform::mat_cache* Transform::getMats() const {
-    auto t = getComputed();
-    if (!t->mats) { t->mats.reset(new mat_cache); goto DIRTY; }
-    if (dirtyMats) {
-    DIRTY:
-        dirtyMats = false;
-        t->updateMats();
-    }
-    return t->mats.get();
-}
-
-void Transform::updateMats() const {
-    const auto t = glm::translate(_position);
-    const auto r = glm::rotate(_rotAngle, _rotAxis);
-    const auto s = glm::scale(_scale);
-    mats->scale = s;
-    mats->rotate = r;
-    mats->translate = t;
-    mats->world = t * r * s;
-}
-
-// WARNING: this is guaranteed to be safe across threads, but the biggest danger is in a single thread
-// If the pointer is copied, then the transform is changed,
-// and then another call to get the pointer is made IN THE SAME THREAD before the old copy is destroyed
-// the program will deadlock because the shared lock will never be released
-// This can be avoided by:
-//   a) not calling getComputed() multiple times in the same (broad) scope (difficult)
-//   b) getting individual values from each getComputed() call (easy, but sometimes inefficient)
-//   c) declaring copy variables, then assigning them in a dedicated scope with a copy of the pointer (ugly, but most efficient for multiple values)
-Transform::safe_tf_ptr Transform::getComputed() const {
-    //if there's no parent, this is already an accurate transform
-    if (!_parent) return safe_tf_ptr(this, computedMut.object);
-    //if there is no previously computed transform, allocate one so we can compute it
-    else if (!computed) computed.reset(new Transform);
-    //if there is a previously computed transform and we haven't made any "dirtying" changes since computing it
-    else if (!dirtyComp) return safe_tf_ptr(computed.get(), computedMut.object);
-    //[re]compute the transform
-    dirtyComp = false;
-    return safe_tf_ptr(computeTransform(), computedMut.object);
-}
-
-Transform* Transform::computeTransform() const {
-    vec3 compPos, compScale;
-    quat compRot;
-    {
-        auto p = _parent->getComputed();
-        compPos   = p->_position;
-        compScale = p->_scale;
-        compRot   = p->_rotation;
-    }
-    compRot   *= _rotation;
-    compScale *= _scale;
-    compPos   += _position;
-    {
-        std::unique_lock<std::shared_mutex> lock(computedMut.object);
-        computed->_position = compPos;
-        computed->_scale    = compScale;
-        computed->_rotation = compRot;
-        computed->updateRot();
+void Transform::Computed::orient(const vec3 baseForward, const vec3 baseUp) {
+    const auto r = quat::toMat3(_rotation);
+    _forward = r * baseForward;
+    _up      = r * baseUp;
+    _right   = glm::cross(_up, _forward);
+}
+
+// Returns a copy of the computed transform, which is always consistent even while another thread is moving it
+// No lock is taken to read it; a transform in a hierarchy only waits if something in the hierarchy changed and has to be flushed first
+Transform::Computed Transform::getComputed() const {
+    if (inHierarchy.load(std::memory_order_acquire)) TransformHierarchy::get().flush();
+
+    uint32_t seq;
+    return readComputed(seq);
+}
+
+// [seq] is set to the sequence the copy was read at
+Transform::Computed Transform::readComputed(uint32_t& seq) const {
+    Computed c;
+    while (true) {
+        seq = computedSeq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        c = computed;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (computedSeq.load(std::memory_order_relaxed) == seq) return c;
     }
-    return computed.get();
 }
 
 void Transform::setComputedPosition(const vec3& compPos) {
     if (_parent) {
-        const auto parentPos = _parent->getComputed()->position();
+        const auto parentPos = _parent->getComputed().position();
         position = compPos - parentPos;
     }
     else {
@@ -99,7 +144,7 @@ void Transform::setComputedPosition(const vec3& compPos) {
 
 void Transform::setComputedRotation(const quat& compRot) {
     if (_parent) {
-        const auto parentRot = _parent->getComputed()->rotation();
+        const auto parentRot = _parent->getComputed().rotation();
         rotation = quat::inverse(parentRot) * compRot;
     }
     else {
@@ -109,7 +154,7 @@ void Transform::setComputedRotation(const quat& compRot) {
 
 void Transform::setComputedScale(const vec3& compScale) {
     if (_parent) {
-        const auto parentScale = _parent->getComputed()->scale();
+        const auto parentScale = _parent->getComputed().scale();
         scale = compScale / parentScale;
     }
     else {
@@ -121,21 +166,16 @@ void Transform::setBaseDirections(const vec3 t_forward, const vec3 t_up) {
     base_forward = t_forward;
     base_up = t_up;
     updateDirections();
+    makeDirty();
 }
 
 void Transform::updateDirections() {
-    const auto r = glm::rotate(_rotAngle, _rotAxis);
-    _forward = (vec3)(r * vec4(base_forward, 1));
-    _up      = (vec3)(r * vec4(base_up, 1));
+    const auto r = quat::toMat3(_rotation);
+    _forward = r * base_forward;
+    _up      = r * base_up;
     _right   = glm::cross(_up, _forward);
 }
 
-void Transform::updateRot() {
-    _rotAngle = _rotation.theta();
-    _rotAxis = _rotation.axis();
-    updateDirections();
-}
-
 //quats are rotated through the rotate function here
 void Transform::rotate(const vec3 v) { rotate(v.x, v.y, v.z); }
 void Transform::rotate(const float x, const float y, const float z) {
@@ -144,7 +184,7 @@ void Transform::rotate(const float x, const float y, const float z) {
     if (y) { _rotation = quat::rotate(_rotation, y, vec3(0, 1, 0)); dirtied = true; }
     if (z) { _rotation = quat::rotate(_rotation, z, vec3(0, 0, 1)); dirtied = true; }
 
-    if (dirtied) { makeDirty(); updateRot(); }
+    if (dirtied) { updateDirections(); makeDirty(); }
 }
 
 void Transform::rotate(const float theta, const vec3 axis) {
@@ -152,5 +192,5 @@ void Transform::rotate(const float theta, const vec3 axis) {
 }
 
 vec3 Transform::getTransformed(const vec3 v) const {
-    return (vec3)(getMats()->world * vec4(v, 1));
+    return (vec3)(getWorldMat() * vec4(v, 1));
 }
\ No newline at end of file
@@ -1,8 +1,7 @@
 #pragma once
 
-#include <unordered_set>
-#include <malloc.h>
-#include <shared_mutex>
+#include <atomic>
+#include <cstdint>
 
 #include "MarchMath.h"
 #include "smart_ptr.h"
@@ -12,21 +11,35 @@ class Transform
 {
 public:
     Transform();
+    Transform(const Transform& other);
+    Transform& operator=(const Transform& other);
+    ~Transform();
 
-    using safe_tf_ptr = safe<const Transform, std::shared_lock<std::shared_mutex>>;
-
-    struct alignas(16) mat_cache {
-        mat4 translate, rotate, scale, world;
-        void* operator new(size_t i) { return _aligned_malloc(i, 16); }
-        void operator delete(void* p) { _aligned_free(p); }
+    // where a transform ends up once all of its parents are applied, which is what getComputed returns
+    struct Computed {
+        ACCS_G (private, vec3, position);
+        ACCS_G (private, vec3, scale) { 1 };
+        ACCS_G (private, quat, rotation);
+    public:
+        vec3 rotAxis()   const { return _rotation.axis(); }
+        float rotAngle() const { return _rotation.theta(); }
+        ACCS_G (private, vec3, forward);
+        ACCS_G (private, vec3, up);
+        ACCS_G (private, vec3, right);
+    private:
+        friend class Transform;
+        friend class TransformHierarchy;
+        void orient(const vec3 baseForward, const vec3 baseUp);
     };
 
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
     void makeDirty();
 
     Transform* parent() const; void parent(Transform* p);
-    std::unordered_set<Transform*> children;
-    safe_tf_ptr getComputed() const;
-    const mat_cache* getMats() const;
+    Computed getComputed() const;
+    // built straight from the computed position, rotation and scale, and cached until the computed transform changes again
+    mat4 getWorldMat() const;
 
     void setComputedPosition(const vec3& compPos);
     void setComputedRotation(const quat& compRot);
@@ -39,11 +52,16 @@ public:
 
     vec3 getTransformed(const vec3 v) const;
 private:
-    PROP_GS (private, Transform, vec3, position, { return _position; }, { makeDirty(); return _position = value; });
-    PROP_GS (private, Transform, vec3, scale,    { return _scale; },    { makeDirty(); return _scale = value; }) { 1 };
-    PROP_GS (private, Transform, quat, rotation, { return _rotation; }, { makeDirty(); _rotation = value; updateRot(); return _rotation; });
-    ACCS_G  (private, vec3, rotAxis);
-    ACCS_G  (private, float, rotAngle);
+    friend class TransformHierarchy;
+
+    PROP_GS (private, Transform, vec3, position, { return _position; }, { _position = value; makeDirty(); return _position; });
+    PROP_GS (private, Transform, vec3, scale,    { return _scale; },    { _scale = value; makeDirty(); return _scale; }) { 1 };
+    PROP_GS (private, Transform, quat, rotation, { return _rotation; }, { _rotation = value; updateDirections(); makeDirty(); return _rotation; });
+public:
+    // quats keep their angle and axis, so these don't cost anything
+    vec3 rotAxis()   const { return _rotation.axis(); }
+    float rotAngle() const { return _rotation.theta(); }
+private:
 
     vec3 base_forward { 0, 0, 1 }
        , base_up      { 0, 1, 0 };
@@ -51,16 +69,39 @@ private:
     ACCS_G (private, vec3, up);
     ACCS_G (private, vec3, right);
 
+    // transforms with a parent or children are nodes of the TransformHierarchy, which computes them all in one pass;
+    // any other transform is already in world space, so its computed transform is just kept in step with it
+    uint32_t node = NO_NODE; // renumbered whenever the hierarchy is sorted, so it's only read under the hierarchy's lock
+    std::atomic<bool> inHierarchy { false };
+    void syncComputed();
+
+    // the parts of the local transform the hierarchy uses, published with their own sequence lock, as the hierarchy can flush on any thread
+    struct Local {
+        vec3 position, scale;
+        quat rotation;
+        vec3 forward, up;
+    };
+    std::atomic<uint32_t> localSeq { 0 };
+    Local local;
+    std::atomic<bool> localDirty { false }; // set each time the local transform is published, and cleared once the hierarchy has read it
+    void publishLocal();
+    Local readLocal() const;
+
+    // either way, the result is published here with a sequence lock, so it can be read from any thread without waiting
+    // the sequence is odd while it's being written; there's only ever one writer, either the hierarchy's flush or the thread moving the transform
+    std::atomic<uint32_t> computedSeq { 0 };
+    Computed computed;
+    void publish(const Computed& c);
+    Computed readComputed(uint32_t& seq) const;
+
+    // the cached world matrix, along with the computedSeq it was built from, so it's rebuilt as soon as the computed transform changes
+    // any thread can build it, so it has a sequence lock of its own; only one thread stores its matrix at a time, and the rest just return theirs
     // computes are const, so these must be mutable
-    mutable bool dirtyComp = true, dirtyMats = true;
-    mutable copy_wrap<std::shared_mutex> computedMut;
-    mutable alloc<Transform> computed;
-    mutable alloc<mat_cache> mats;
+    mutable std::atomic<uint32_t> worldMatSeq { 0 };
+    mutable uint32_t worldMatKey = 1; // computedSeq is never odd once it's been read, so this never matches
+    mutable mat4 worldMat;
 
     Transform* _parent = nullptr;
-    Transform* computeTransform() const;
 
     void updateDirections();
-    void updateRot();
-    void updateMats() const;
-};
\ No newline at end of file
+};
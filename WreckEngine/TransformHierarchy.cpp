@@ -0,0 +1,153 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+
+void TransformHierarchy::flush() {
+    if (!anyDirty.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(mut);
+    // another thread may have flushed while this one waited
+    if (!anyDirty.exchange(false, std::memory_order_acq_rel)) return;
+    if (unsorted) sort();
+
+    // parents come first, so by the time a node is reached its parent is already up to date
+    for (size_t i = 0, n = owners.size(); i < n; ++i) {
+        const auto t = owners[i];
+        const auto p = parents[i];
+        const auto moved = t->localDirty.load(std::memory_order_relaxed) && t->localDirty.exchange(false, std::memory_order_acquire);
+        changed[i] = moved || dirty[i] || (p != NONE && changed[p]);
+        if (!changed[i]) continue;
+
+        if (moved || dirty[i]) {
+            dirty[i] = false;
+            locals[i] = t->readLocal();
+        }
+
+        const auto& local = locals[i];
+        auto& w = world[i];
+        if (p == NONE) {
+            w._position = local.position;
+            w._scale    = local.scale;
+            w._rotation = local.rotation;
+        }
+        else {
+            const auto& parent = world[p];
+            w._position = parent._position + local.position;
+            w._scale    = parent._scale * local.scale;
+            w._rotation = parent._rotation * local.rotation;
+        }
+        w.orient(local.forward, local.up);
+
+        t->publish(w);
+    }
+}
+
+void TransformHierarchy::parent(Transform* child, Transform* p) {
+    std::lock_guard<std::mutex> lock(mut);
+    const auto old = child->_parent;
+    child->_parent = p;
+
+    if (p) {
+        add(p);
+        add(child);
+        parents[child->node] = p->node;
+    }
+    else {
+        parents[child->node] = NONE;
+        prune(child);
+    }
+    if (old) prune(old);
+
+    unsorted = true;
+    anyDirty = true;
+}
+
+void TransformHierarchy::remove(Transform* t) {
+    std::lock_guard<std::mutex> lock(mut);
+    const auto node = t->node;
+    const auto old = t->_parent;
+
+    // the children become roots in their own right
+    std::vector<Transform*> orphans;
+    for (size_t i = 0, n = owners.size(); i < n; ++i) {
+        if (parents[i] != node) continue;
+        parents[i] = NONE;
+        owners[i]->_parent = nullptr;
+        orphans.push_back(owners[i]);
+    }
+
+    t->_parent = nullptr;
+    parents[node] = NONE;
+    dirty[node] = false;
+    owners[node] = nullptr;
+    t->node = NONE;
+    t->inHierarchy.store(false, std::memory_order_release);
+
+    if (old) prune(old);
+    for (auto orphan : orphans) prune(orphan);
+
+    unsorted = true;
+    anyDirty = true;
+}
+
+void TransformHierarchy::add(Transform* t) {
+    if (t->node != NONE) return;
+    // nothing is moving it while the shape changes, so it can publish its local transform from here
+    t->publishLocal();
+    t->inHierarchy.store(true, std::memory_order_release);
+    t->node = (uint32_t)owners.size();
+    owners.push_back(t);
+    parents.push_back(NONE);
+    locals.emplace_back();
+    world.emplace_back();
+    dirty.push_back(true);
+    changed.push_back(false);
+}
+
+// takes [t] out of the hierarchy if it's no longer part of one; its slot is cleared out on the next sort
+void TransformHierarchy::prune(Transform* t) {
+    const auto node = t->node;
+    if (node == NONE || t->_parent || hasChildren(node)) return;
+    dirty[node] = false;
+    owners[node] = nullptr;
+    t->node = NONE;
+    t->inHierarchy.store(false, std::memory_order_release);
+    t->syncComputed();
+}
+
+bool TransformHierarchy::hasChildren(const uint32_t node) const {
+    return std::find(parents.begin(), parents.end(), node) != parents.end();
+}
+
+// only happens after the shape changes, so it isn't worth being clever; everything gets recomputed afterwards
+void TransformHierarchy::sort() {
+    const auto n = owners.size();
+    std::vector<uint32_t> depth(n), order;
+    for (size_t i = 0; i < n; ++i) {
+        if (!owners[i]) continue;
+        for (auto p = parents[i]; p != NONE; p = parents[p]) ++depth[i];
+        order.push_back((uint32_t)i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&depth](const uint32_t a, const uint32_t b) { return depth[a] < depth[b]; });
+
+    std::vector<uint32_t> remap(n, NONE);
+    for (size_t i = 0, m = order.size(); i < m; ++i)
+        remap[order[i]] = (uint32_t)i;
+
+    std::vector<Transform*> sortedOwners(order.size());
+    std::vector<uint32_t> sortedParents(order.size());
+    for (size_t i = 0, m = order.size(); i < m; ++i) {
+        const auto old = order[i];
+        sortedOwners[i] = owners[old];
+        sortedParents[i] = parents[old] == NONE ? NONE : remap[parents[old]];
+        sortedOwners[i]->node = (uint32_t)i;
+    }
+    owners.swap(sortedOwners);
+    parents.swap(sortedParents);
+
+    const auto m = owners.size();
+    locals.resize(m);
+    world.resize(m);
+    dirty.assign(m, true);
+    changed.assign(m, false);
+    unsorted = false;
+}
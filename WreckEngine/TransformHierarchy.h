@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "Transform.h"
+
+/*
+----------------------------------------------------------------------
+- Stores every transform that has a parent or children in flat arrays, sorted by depth so each parent comes before its children
+  - Transforms join when they're first parented, and leave once they have neither a parent nor children
+  - Each node keeps its parent's index, a copy of its local transform, and its computed transform
+- Marking a node dirty is just setting a flag on its transform, however deep its subtree is
+  - The flag lives on the transform rather than in the arrays, as the arrays are reallocated and reordered under the lock
+  - The transform publishes its local transform with a sequence lock first, so flush never reads one that's partway through being written
+- flush recomputes everything that's dirty in one pass over the arrays, in order
+  - A node is recomputed if it's dirty or its parent was, so whole subtrees come along without any recursion
+  - Only dirty nodes have their local transforms read from their owners
+  - Nothing is done at all when nothing is dirty
+- Changing the hierarchy's shape just marks it for a re-sort, which the next flush does before recomputing everything
+- Each recomputed node is published to its owner, which is where getComputed reads it from without any lock
+  - Flushing and changing the shape are serialized with a mutex, which readers only take when there's something to flush
+  - Shape changes can't be made while the transforms involved are being moved on other threads
+----------------------------------------------------------------------
+*/
+class TransformHierarchy {
+public:
+    // never destroyed, as transforms in static storage can outlive it
+    static TransformHierarchy& get() { static auto hierarchy = new TransformHierarchy; return *hierarchy; }
+
+    static constexpr uint32_t NONE = Transform::NO_NODE;
+
+    size_t size() const { return owners.size(); }
+
+    // called once a node's transform has set its own dirty flag
+    void markDirty() { anyDirty.store(true, std::memory_order_release); }
+    void flush();
+
+private:
+    friend class Transform;
+
+    void parent(Transform* child, Transform* p);
+    void remove(Transform* t);
+
+    void add(Transform* t);
+    void prune(Transform* t);
+    bool hasChildren(uint32_t node) const;
+    void sort();
+
+    std::vector<Transform*> owners; // null for nodes that have left since the last sort
+    std::vector<uint32_t> parents;
+    std::vector<Transform::Local> locals;
+    std::vector<Transform::Computed> world;
+    // dirty marks nodes whose locals have to be read again regardless of their owners' flags, e.g. after a sort;
+    // changed is only used by the pass, and is kept to avoid reallocating it
+    std::vector<uint8_t> dirty, changed;
+
+    std::atomic<bool> anyDirty { false };
+    bool unsorted = false;
+    std::mutex mut;
+};
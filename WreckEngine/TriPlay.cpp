@@ -341,6 +341,7 @@ void TriPlay::postUpdate() {
 
 void TriPlay::physicsUpdate(double dt) {
     Game::physicsUpdate(dt);
+    RigidBodyWorld::get().update((float)dt);
     CollisionManager::getInstance().update((float)dt);
 }
 
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+/*--------------------------------------------------------------------------------------------------
+  - A vector that keeps its first N elements inline, so building up a handful of values never touches the heap
+    - Meant for short-lived scratch data in hot paths, e.g. contact points and clip polygons, which are almost always tiny
+    - Pushing past N moves everything onto the heap, and it stays there until it's cleared or emptied
+      - This keeps it correct for inputs of any size; pick N so that only unusual inputs get there
+  - Only trivially copyable types are allowed, so it can copy and shift elements as plain bytes
+    - Copying one copies its whole inline buffer, so N should stay small for anything that gets copied around
+  - Iterators are plain pointers, and are invalidated by anything that changes the size
+--------------------------------------------------------------------------------------------------*/
+template<typename T, size_t N>
+class small_vector {
+    static_assert(std::is_trivially_copyable_v<T>, "small_vector only holds trivially copyable types");
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    small_vector() = default;
+    small_vector(std::initializer_list<T> values) { insert(values.begin(), values.end()); }
+
+    size_t size() const { return spill.empty() ? count : spill.size(); }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t inline_capacity() { return N; }
+
+    T* data()             { return spill.empty() ? local() : spill.data(); }
+    const T* data() const { return spill.empty() ? local() : spill.data(); }
+
+    T* begin() { return data(); }
+    T* end()   { return data() + size(); }
+    const T* begin() const { return data(); }
+    const T* end()   const { return data() + size(); }
+
+    T& operator[](size_t i)             { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+    T& front() { return data()[0]; }
+    T& back()  { return data()[size() - 1]; }
+    const T& front() const { return data()[0]; }
+    const T& back()  const { return data()[size() - 1]; }
+
+    void push_back(const T& value) {
+        if (!spill.empty()) spill.push_back(value);
+        else if (count < N) local()[count++] = value;
+        else {
+            spill.reserve(N * 2);
+            spill.assign(local(), local() + N);
+            spill.push_back(value);
+            count = 0;
+        }
+    }
+
+    void pop_back() {
+        if (!spill.empty()) spill.pop_back();
+        else --count;
+    }
+
+    template<typename Iter>
+    void insert(Iter first, Iter last) {
+        for (; first != last; ++first) push_back(*first);
+    }
+
+    // removes the element at [pos], shifting the rest down
+    T* erase(T* pos) {
+        const auto index = pos - data();
+        if (!spill.empty()) return spill.data() + (spill.erase(spill.begin() + index) - spill.begin());
+        std::memmove(pos, pos + 1, (count - index - 1) * sizeof(T));
+        --count;
+        return pos;
+    }
+
+    // keeps any heap storage it has, but goes back to using the inline buffer
+    void clear() {
+        spill.clear();
+        count = 0;
+    }
+
+private:
+    T* local()             { return reinterpret_cast<T*>(buffer); }
+    const T* local() const { return reinterpret_cast<const T*>(buffer); }
+
+    size_t count = 0; // the number of inline elements; 0 once spilled
+    alignas(T) unsigned char buffer[sizeof(T) * N];
+    std::vector<T> spill;
+};
@@ -29,8 +29,8 @@ struct safe_ptr {
 
     safe_ptr(T* ptr, mutex_t& mut) : value(ptr), lock(mut) {}
     template<typename = std::enable_if_t<std::is_copy_constructible<T>::value>>
-    auto operator*() { return *value; }
-    auto operator->() { return value; }
+    auto operator*() const { return *value; }
+    auto operator->() const { return value; }
 
     safe_ptr(safe_ptr&&) = default;
     safe_ptr& operator=(safe_ptr&&) = default;
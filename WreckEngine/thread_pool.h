@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*--------------------------------------------------------------------------------------------------
+  - A fixed set of worker threads used to split data-parallel loops across cores
+
+  - parallel_for divides a range into chunks and hands them out to the workers and the calling thread
+    - The caller always participates, so a pool with no workers just runs the loop inline
+    - It blocks until every chunk is complete, so the callable can safely capture by reference
+    - Each invocation of the callable is given a thread index in [0, size()), unique among concurrently running chunks
+      - This is intended for indexing per-thread buffers without any synchronization
+      - The calling thread is always index 0
+
+  - Only one loop runs on the pool at a time; concurrent calls from other threads wait their turn
+    - So work that mustn't wait on the engine's loops (e.g. game updates, see State) should have a pool of its own
+    - Calling parallel_for from inside one of the same pool's chunks runs the inner loop inline, with the thread index of the chunk it was called from
+      - This lets code that's itself parallel be called from anything that runs on the pool
+      - Calling into a different pool from a chunk is dispatched as usual
+  - Pool threads never call Time::update(), so anything relying on the frame count (e.g. frame_cache)
+    must be refreshed by the calling thread before the loop starts
+--------------------------------------------------------------------------------------------------*/
+class thread_pool {
+public:
+    using job_t = std::function<void(size_t, size_t, size_t)>; // begin, end, thread index
+
+    explicit thread_pool(size_t numWorkers = std::max(std::thread::hardware_concurrency(), 1u) - 1) {
+        workers.reserve(numWorkers);
+        for (size_t i = 0; i < numWorkers; ++i)
+            workers.emplace_back([this, i] { work(i + 1); });
+    }
+
+    ~thread_pool() {
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // the shared pool used by the engine's systems, e.g. physics
+    static thread_pool& get() { static thread_pool pool; return pool; }
+
+    // the number of threads that can run chunks, including the caller
+    size_t size() const { return workers.size() + 1; }
+
+    // runs func(begin, end, threadIndex) over [0, count) in chunks of [grain] elements
+    template<typename Func>
+    void parallel_for(size_t count, size_t grain, Func&& func) {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+        if (chunkPool == this) {
+            func(size_t{ 0 }, count, chunkThread);
+            return;
+        }
+        if (workers.empty() || count <= grain) {
+            func(size_t{ 0 }, count, size_t{ 0 });
+            return;
+        }
+
+        std::lock_guard<std::mutex> dispatchLock(dispatchMut);
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            job = [&func](size_t begin, size_t end, size_t thread) { func(begin, end, thread); };
+            jobCount = count;
+            jobGrain = grain;
+            next = 0;
+            active = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+
+        run(0);
+
+        std::unique_lock<std::mutex> lock(mut);
+        done.wait(lock, [this] { return active == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mut, dispatchMut;
+    std::condition_variable wake, done;
+    bool stopping = false;
+    size_t generation = 0;
+
+    job_t job;
+    size_t jobCount = 0, jobGrain = 1;
+    std::atomic<size_t> next = 0;
+    size_t active = 0;
+
+    // the pool and thread index of the thread's current chunk, so loops started inside one know to run inline
+    static inline thread_local const thread_pool* chunkPool = nullptr;
+    static inline thread_local size_t chunkThread = 0;
+
+    void run(size_t threadIndex) {
+        const auto outerPool = chunkPool;
+        const auto outerThread = chunkThread;
+        chunkPool = this;
+        chunkThread = threadIndex;
+        for (auto begin = next.fetch_add(jobGrain); begin < jobCount; begin = next.fetch_add(jobGrain)) {
+            job(begin, std::min(begin + jobGrain, jobCount), threadIndex);
+        }
+        chunkPool = outerPool;
+        chunkThread = outerThread;
+    }
+
+    void work(size_t threadIndex) {
+        size_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+            }
+
+            run(threadIndex);
+
+            std::unique_lock<std::mutex> lock(mut);
+            if (--active == 0) done.notify_one();
+        }
+    }
+};
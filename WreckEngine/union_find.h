@@ -0,0 +1,47 @@
+#pragma once
+
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/*--------------------------------------------------------------------------------------------------
+  - Disjoint sets over the indices [0, size()), used to group connected elements (e.g. simulation islands)
+
+  - unite() merges the smaller set into the larger one, and find() halves the path it walks as it goes
+    - Together they keep every operation effectively constant time
+  - reset() reuses the existing storage, so sets can be rebuilt every frame without allocating
+--------------------------------------------------------------------------------------------------*/
+class union_find {
+public:
+    void reset(size_t count) {
+        parents.resize(count);
+        std::iota(begin(parents), end(parents), size_t{ 0 });
+        sizes.assign(count, 1);
+    }
+
+    size_t size() const { return parents.size(); }
+
+    // the representative of the set containing [i]
+    size_t find(size_t i) {
+        while (parents[i] != i) {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+        return i;
+    }
+
+    // returns false if [a] and [b] were already in the same set
+    bool unite(size_t a, size_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+
+        if (sizes[a] < sizes[b]) std::swap(a, b);
+        parents[b] = a;
+        sizes[a] += sizes[b];
+        return true;
+    }
+
+private:
+    std::vector<size_t> parents, sizes;
+};